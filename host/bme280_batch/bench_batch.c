@@ -0,0 +1,127 @@
+#include "bme280_batch.h"
+#include "bme280_measure.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// Throughput benchmark for the batch compensation. Also checks the
+// vectorized batch results against the scalar compensate_temp /
+// compensate_hum built for the host from the firmware sources. That proves
+// batch == scalar on the host, not a comparison with AVR output.
+// Usage: bench_batch [samples] [max_threads]
+
+#define BENCH_REPEATS 3
+
+// Calibration of a real sensor, values as read by bme_load_comp_vals.
+static const SensorConstants bench_constants = {
+    .dig_T1 = 28490, .dig_T2 = 26237, .dig_T3 = 50,
+    .dig_H1 = 75, .dig_H2 = 362, .dig_H3 = 0,
+    .dig_H4 = 323, .dig_H5 = 50, .dig_H6 = 30,
+};
+
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+static uint32_t xorshift32(uint32_t *state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+
+// Compare every sample with the scalar functions.
+static size_t verify(const RawBatch *rbp, const CompensatedBatch *cbp) {
+  SensorConstants sc = bench_constants;
+  size_t mismatches = 0;
+  for (size_t i = 0; i < rbp->count; i++) {
+    int32_t temperature = compensate_temp(rbp->temperature_raw[i], &sc);
+    uint32_t humidity = compensate_hum(rbp->humidity_raw[i], &sc);
+    if ((temperature != cbp->temperature[i]) ||
+        (sc.t_fine != cbp->t_fine[i]) || (humidity != cbp->humidity[i])) {
+      if (mismatches < 10) {
+        fprintf(stderr, "mismatch at %zu: raw %u/%u, got %d/%u, want %d/%u\n",
+                i, rbp->temperature_raw[i], rbp->humidity_raw[i],
+                cbp->temperature[i], cbp->humidity[i], temperature, humidity);
+      }
+      mismatches++;
+    }
+  }
+  return mismatches;
+}
+
+
+int main(int argc, char **argv) {
+  size_t count = (argc > 1 ? strtoull(argv[1], NULL, 0) : (size_t)1 << 22);
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  unsigned max_threads = (argc > 2 ? (unsigned)strtoul(argv[2], NULL, 0)
+                                   : (unsigned)(online > 0 ? online : 1));
+  uint32_t *raw_temp = malloc(count * sizeof(uint32_t));
+  uint32_t *raw_hum = malloc(count * sizeof(uint32_t));
+  int32_t *temperature = malloc(count * sizeof(int32_t));
+  int32_t *t_fine = malloc(count * sizeof(int32_t));
+  uint32_t *humidity = malloc(count * sizeof(uint32_t));
+  if (!raw_temp || !raw_hum || !temperature || !t_fine || !humidity) {
+    fprintf(stderr, "out of memory for %zu samples\n", count);
+    return 1;
+  }
+  // Full 20 bit / 16 bit ADC range, so the clamping paths are covered too.
+  uint32_t state = 0x2545F491;
+  for (size_t i = 0; i < count; i++) {
+    raw_temp[i] = xorshift32(&state) & 0xFFFFF;
+    raw_hum[i] = xorshift32(&state) & 0xFFFF;
+  }
+  RawBatch raw = {raw_temp, raw_hum, count};
+  CompensatedBatch comp = {temperature, t_fine, humidity};
+
+  bme_batch_compensate(&bench_constants, &raw, &comp, max_threads);
+  size_t mismatches = verify(&raw, &comp);
+  printf("verify: %zu samples, %zu mismatches against the scalar code\n", count,
+         mismatches);
+  if (mismatches != 0) {
+    return 1;
+  }
+
+  // Baseline: scalar functions one sample at a time.
+  SensorConstants sc = bench_constants;
+  double start = now_seconds();
+  for (size_t i = 0; i < count; i++) {
+    temperature[i] = compensate_temp(raw_temp[i], &sc);
+    humidity[i] = compensate_hum(raw_hum[i], &sc);
+  }
+  double elapsed = now_seconds() - start;
+  printf("scalar   1 thread : %8.1f Msamples/s, %8.1f Msamples/s/core\n",
+         count / elapsed * 1e-6, count / elapsed * 1e-6);
+
+  // No t_fine output, that's the common case for ingestion.
+  comp.t_fine = NULL;
+  for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+    double best = 1e30;
+    for (int rep = 0; rep < BENCH_REPEATS; rep++) {
+      start = now_seconds();
+      bme_batch_compensate(&bench_constants, &raw, &comp, threads);
+      elapsed = now_seconds() - start;
+      best = (elapsed < best ? elapsed : best);
+    }
+    printf("batch  %3u threads: %8.1f Msamples/s, %8.1f Msamples/s/core\n",
+           threads, count / best * 1e-6, count / best * 1e-6 / threads);
+    if ((threads < max_threads) && (threads * 2 > max_threads)) {
+      threads = max_threads / 2;
+    }
+  }
+  free(raw_temp);
+  free(raw_hum);
+  free(temperature);
+  free(t_fine);
+  free(humidity);
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include "bme280_batch.h"
+#include "bme280_compensate.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// Samples per inner block. The intermediate t_fine values of a block stay in
+// L1 cache between the temperature and the humidity pass.
+#define BATCH_BLOCK_LEN 1024
+// Below this many samples per thread, spawning threads costs more than it
+// saves.
+#define BATCH_MIN_PER_THREAD (1 << 16)
+#define BATCH_MAX_THREADS 256
+
+// The archive is built for the baseline ISA, the hot loops get extra
+// clones for newer x86 CPUs and the best one is picked at load time.
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BATCH_CLONES                                                           \
+  __attribute__((target_clones("avx512f", "avx2", "sse4.1", "default")))
+#else
+#define BATCH_CLONES
+#endif
+
+typedef struct {
+  const SensorConstants *scp;
+  const RawBatch *rbp;
+  CompensatedBatch *cbp;
+  size_t begin;
+  size_t end;
+} BatchSlice;
+
+
+// Temperature pass, written as a plain loop over restrict pointers so the
+// compiler can vectorize it (all operations are 32 bit lane wise).
+BATCH_CLONES
+static void compensate_temp_block(const SensorConstants *scp,
+                                  const uint32_t *restrict raw_temp,
+                                  int32_t *restrict temperature,
+                                  int32_t *restrict t_fine, size_t len) {
+  // Local copy, so the constants don't have to be reloaded after each store.
+  const SensorConstants sc = *scp;
+  for (size_t i = 0; i < len; i++) {
+    t_fine[i] = bme_calc_t_fine(raw_temp[i], &sc);
+    temperature[i] = bme_calc_temp(t_fine[i]);
+  }
+}
+
+
+BATCH_CLONES
+static void compensate_hum_block(const SensorConstants *scp,
+                                 const uint32_t *restrict raw_hum,
+                                 const int32_t *restrict t_fine,
+                                 uint32_t *restrict humidity, size_t len) {
+  const SensorConstants sc = *scp;
+  for (size_t i = 0; i < len; i++) {
+    humidity[i] = bme_calc_hum(raw_hum[i], t_fine[i], &sc);
+  }
+}
+
+
+static void compensate_slice(const BatchSlice *slice) {
+  const RawBatch *rbp = slice->rbp;
+  CompensatedBatch *cbp = slice->cbp;
+  int32_t t_fine_buf[BATCH_BLOCK_LEN];
+  for (size_t pos = slice->begin; pos < slice->end; pos += BATCH_BLOCK_LEN) {
+    size_t len = slice->end - pos;
+    len = (len > BATCH_BLOCK_LEN ? BATCH_BLOCK_LEN : len);
+    int32_t *t_fine = (cbp->t_fine != NULL ? cbp->t_fine + pos : t_fine_buf);
+    compensate_temp_block(slice->scp, rbp->temperature_raw + pos,
+                          cbp->temperature + pos, t_fine, len);
+    if (rbp->humidity_raw != NULL) {
+      compensate_hum_block(slice->scp, rbp->humidity_raw + pos, t_fine,
+                           cbp->humidity + pos, len);
+    }
+  }
+}
+
+
+static void *compensate_worker(void *arg) {
+  compensate_slice((const BatchSlice *)arg);
+  return NULL;
+}
+
+
+int bme_batch_compensate(const SensorConstants *scp, const RawBatch *rbp,
+                         CompensatedBatch *cbp, unsigned num_threads) {
+  if ((scp == NULL) || (rbp == NULL) || (cbp == NULL) ||
+      (rbp->temperature_raw == NULL) || (cbp->temperature == NULL)) {
+    // Error: Missing input or output buffer!
+    return 1;
+  }
+  if ((rbp->humidity_raw != NULL) && (cbp->humidity == NULL)) {
+    // Error: No room for the humidity results!
+    return 2;
+  }
+  if (num_threads == 0) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    num_threads = (online > 0 ? (unsigned)online : 1);
+  }
+  size_t max_threads = rbp->count / BATCH_MIN_PER_THREAD;
+  if (num_threads > max_threads) {
+    num_threads = (max_threads > 0 ? (unsigned)max_threads : 1);
+  }
+  if (num_threads > BATCH_MAX_THREADS) {
+    num_threads = BATCH_MAX_THREADS;
+  }
+
+  BatchSlice slices[BATCH_MAX_THREADS];
+  pthread_t threads[BATCH_MAX_THREADS];
+  // Split on block boundaries so the threads never share a cache line of
+  // the output arrays.
+  size_t blocks = (rbp->count + BATCH_BLOCK_LEN - 1) / BATCH_BLOCK_LEN;
+  size_t pos = 0;
+  for (unsigned i = 0; i < num_threads; i++) {
+    size_t slice_blocks = blocks / num_threads + (i < blocks % num_threads);
+    size_t end = pos + slice_blocks * BATCH_BLOCK_LEN;
+    slices[i] = (BatchSlice){scp, rbp, cbp, pos,
+                             (end > rbp->count ? rbp->count : end)};
+    pos = slices[i].end;
+  }
+  // The calling thread works on the first slice itself.
+  unsigned started = 1;
+  for (; started < num_threads; started++) {
+    if (pthread_create(&threads[started], NULL, compensate_worker,
+                       &slices[started]) != 0) {
+      break;
+    }
+  }
+  compensate_slice(&slices[0]);
+  // Slices whose thread couldn't be started are done here as well.
+  for (unsigned i = started; i < num_threads; i++) {
+    compensate_slice(&slices[i]);
+  }
+  for (unsigned i = 1; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  return 0;
+}
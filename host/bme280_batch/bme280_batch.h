@@ -0,0 +1,36 @@
+#ifndef BME280_BATCH_H
+#define BME280_BATCH_H
+#include "bme280_measure.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Host side batch version of compensate_temp and compensate_hum.
+// Compiled from the same source as the firmware (bme280_compensate.h) with
+// -fwrapv, the integer expressions are evaluated with the same widths on
+// both targets.
+
+// Raw ADC words as structure of arrays, sample i of every array belongs to
+// the same measurement.
+typedef struct {
+  const uint32_t *temperature_raw;
+  // May be NULL if only temperatures are needed.
+  const uint32_t *humidity_raw;
+  size_t count;
+} RawBatch;
+
+// Output buffers, each one with room for RawBatch.count values.
+typedef struct {
+  // Temperature in 0.01 degrees.
+  int32_t *temperature;
+  // May be NULL, otherwise receives t_fine of every sample.
+  int32_t *t_fine;
+  // Humidity in Q22.10 %RH, ignored if RawBatch.humidity_raw is NULL.
+  uint32_t *humidity;
+} CompensatedBatch;
+
+// Compensate a whole batch with a single set of sensor constants.
+// num_threads: Worker threads to use, 0 picks the number of online cores.
+// Returns 0 for success.
+int bme_batch_compensate(const SensorConstants *scp, const RawBatch *rbp,
+                         CompensatedBatch *cbp, unsigned num_threads);
+#endif // BME280_BATCH_H
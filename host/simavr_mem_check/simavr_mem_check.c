@@ -0,0 +1,185 @@
+#include "mem_usage.h"
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+// Runs a firmware built with -DMEM_USAGE_ENABLED in simavr and checks the
+// numbers in mem_usage_stats against limits. The layout and the subsystem
+// list come from lib/mem_usage/mem_usage.h, the same header the firmware
+// is built with.
+// Exit code 0 if within the limits, 1 if not, 2 on setup errors.
+
+#define MEM_CHECK_MCU "atmega328p"
+#define MEM_CHECK_FREQ 16000000UL
+// Data addresses are linked with this offset on AVR.
+#define AVR_DATA_OFFSET 0x800000
+
+#define MEM_SUBSYS_ID(id, name) #id,
+static const char *const subsys_ids[MEM_SUBSYS_COUNT] = {
+    MEM_SUBSYS_LIST(MEM_SUBSYS_ID)};
+#define MEM_SUBSYS_NAME(id, name) name,
+static const char *const subsys_names[MEM_SUBSYS_COUNT] = {
+    MEM_SUBSYS_LIST(MEM_SUBSYS_NAME)};
+
+
+static uint16_t read_u16(const avr_t *avr, uint32_t addr) {
+  return avr->data[addr] | ((uint16_t)avr->data[addr + 1] << 8);
+}
+
+
+static int find_symbol(const elf_firmware_t *fw, const char *name,
+                       uint32_t *addr) {
+  for (uint32_t i = 0; i < fw->symbolcount; i++) {
+    if (strcmp(fw->symbol[i]->symbol, name) == 0) {
+      *addr = fw->symbol[i]->addr;
+      if (*addr >= AVR_DATA_OFFSET) {
+        *addr -= AVR_DATA_OFFSET;
+      }
+      return 0;
+    }
+  }
+  return 1;
+}
+
+
+// Parse "<subsystem>=<bytes>", the subsystem as its MEM_SUBSYS_ id in any
+// case, e.g. bme_measure=400. Returns 0 for success.
+static int parse_subsys_limit(const char *arg, unsigned long *limits) {
+  const char *equal = strchr(arg, '=');
+  if (equal == NULL) {
+    return 1;
+  }
+  for (int i = 0; i < MEM_SUBSYS_COUNT; i++) {
+    if ((strlen(subsys_ids[i]) == (size_t)(equal - arg)) &&
+        (strncasecmp(arg, subsys_ids[i], equal - arg) == 0)) {
+      limits[i] = strtoul(equal + 1, NULL, 0);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options] firmware.elf\n"
+          "  -t seconds          simulated run time (default 12)\n"
+          "  -s bytes            max stack peak (default 1024)\n"
+          "  -f bytes            min free SRAM (default 256)\n"
+          "  -p subsystem=bytes  max stack peak of a subsystem, repeatable\n",
+          name);
+}
+
+
+int main(int argc, char **argv) {
+  double seconds = 12;
+  unsigned long max_stack = 1024;
+  unsigned long min_free = 256;
+  // 0 for no limit.
+  unsigned long subsys_limits[MEM_SUBSYS_COUNT] = {0};
+  int opt;
+  while ((opt = getopt(argc, argv, "t:s:f:p:")) != -1) {
+    switch (opt) {
+    case 't':
+      seconds = strtod(optarg, NULL);
+      break;
+    case 's':
+      max_stack = strtoul(optarg, NULL, 0);
+      break;
+    case 'f':
+      min_free = strtoul(optarg, NULL, 0);
+      break;
+    case 'p':
+      if (parse_subsys_limit(optarg, subsys_limits) != 0) {
+        fprintf(stderr, "unknown subsystem limit %s\n", optarg);
+        return 2;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  elf_firmware_t fw;
+  memset(&fw, 0, sizeof(fw));
+  if (elf_read_firmware(argv[optind], &fw) != 0) {
+    fprintf(stderr, "%s: can't read firmware\n", argv[optind]);
+    return 2;
+  }
+  uint32_t stats_addr;
+  if (find_symbol(&fw, "mem_usage_stats", &stats_addr) != 0) {
+    fprintf(stderr, "mem_usage_stats not found, build with "
+                    "-DMEM_USAGE_ENABLED\n");
+    return 2;
+  }
+  avr_t *avr = avr_make_mcu_by_name(MEM_CHECK_MCU);
+  if (avr == NULL) {
+    fprintf(stderr, "simavr doesn't know %s\n", MEM_CHECK_MCU);
+    return 2;
+  }
+  avr_init(avr);
+  avr->frequency = MEM_CHECK_FREQ;
+  avr_load_firmware(avr, &fw);
+
+  // No sensor is simulated, the bus transfers fail and the status paths run.
+  // The measure and send checkpoints are still passed on every period.
+  avr_cycle_count_t limit = (avr_cycle_count_t)(seconds * MEM_CHECK_FREQ);
+  int state = cpu_Running;
+  while ((avr->cycle < limit) && (state != cpu_Done) &&
+         (state != cpu_Crashed)) {
+    state = avr_run(avr);
+  }
+
+  MemUsageStats stats;
+  stats.static_size =
+      read_u16(avr, stats_addr + offsetof(MemUsageStats, static_size));
+  stats.stack_peak =
+      read_u16(avr, stats_addr + offsetof(MemUsageStats, stack_peak));
+  stats.free_min = read_u16(avr, stats_addr + offsetof(MemUsageStats, free_min));
+  for (int i = 0; i < MEM_SUBSYS_COUNT; i++) {
+    stats.subsys_peak[i] = read_u16(
+        avr, stats_addr + offsetof(MemUsageStats, subsys_peak) +
+                 i * sizeof(uint16_t));
+  }
+
+  int failed = 0;
+  printf("static %u B, stack peak %u B (max %lu), free min %u B (min %lu)\n",
+         stats.static_size, stats.stack_peak, max_stack, stats.free_min,
+         min_free);
+  for (int i = 0; i < MEM_SUBSYS_COUNT; i++) {
+    printf("peak %s: %u B", subsys_names[i], stats.subsys_peak[i]);
+    if (subsys_limits[i] != 0) {
+      printf(" (max %lu)", subsys_limits[i]);
+      if (stats.subsys_peak[i] > subsys_limits[i]) {
+        failed = 1;
+      }
+    }
+    printf("\n");
+  }
+  if (state == cpu_Crashed) {
+    fprintf(stderr, "FAIL: firmware crashed\n");
+    return 1;
+  }
+  if ((stats.stack_peak == 0) || (stats.free_min == UINT16_MAX)) {
+    fprintf(stderr, "FAIL: no checkpoint reached within %.1f s\n", seconds);
+    return 1;
+  }
+  if ((stats.stack_peak > max_stack) || (stats.free_min < min_free) ||
+      failed) {
+    fprintf(stderr, "FAIL: memory limits exceeded\n");
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
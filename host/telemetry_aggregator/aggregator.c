@@ -0,0 +1,488 @@
+#define _GNU_SOURCE
+#include "load_test.h"
+#include "record_ring.h"
+#include "telemetry_parse.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// Collects the text output of many nodes (serial devices or ptys), parses
+// it in place and writes one merged line per record:
+//   <unix time with ns> <node> <kind> <value> <status>
+// kind: I initialization, C loading compensation values, T temperature in
+// °C, H humidity in %RH, P raw pressure, R samples per second, E failed
+// measurement (status only). value is "-"
+// for records without a value, status is "-" for records without a status
+// (compact format, pressure and rate).
+
+// Longest line the firmware prints is well below this, longer lines are
+// counted and skipped.
+#define ENDPOINT_BUF_LEN 256
+#define EPOLL_BATCH 256
+#define EPOLL_TIMEOUT_MS 100
+#define OUTPUT_TAG UINT32_MAX
+#define RECORD_MAX_LEN 96
+
+typedef struct {
+  int fd;
+  // Number of valid bytes in buf.
+  uint16_t fill;
+  // Set while the rest of an overlong line is discarded.
+  uint8_t skipping;
+  TelemetryParser parser;
+  char buf[ENDPOINT_BUF_LEN];
+} Endpoint;
+
+typedef struct {
+  uint64_t lines;
+  uint64_t records;
+  uint64_t overlong;
+  uint64_t bytes_in;
+} Stats;
+
+static volatile sig_atomic_t running = 1;
+
+
+static void handle_signal(int sig) {
+  (void)sig;
+  running = 0;
+}
+
+
+static speed_t baud_to_speed(unsigned long baud) {
+  switch (baud) {
+  case 9600:
+    return B9600;
+  case 19200:
+    return B19200;
+  case 38400:
+    return B38400;
+  case 57600:
+    return B57600;
+  case 115200:
+    return B115200;
+  case 230400:
+    return B230400;
+  case 460800:
+    return B460800;
+  case 500000:
+    return B500000;
+  case 921600:
+    return B921600;
+  case 1000000:
+    return B1000000;
+  default:
+    return B0;
+  }
+}
+
+
+// Open a serial device or pty raw and non blocking.
+static int endpoint_open(const char *path, speed_t speed) {
+  int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    // No echo, no line discipline, 8N1.
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  return fd;
+}
+
+
+// Append the decimal digits of value, returns the new end.
+static char *put_unsigned(char *pos, uint64_t value) {
+  char digits[20];
+  int len = 0;
+  do {
+    digits[len++] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+  while (len > 0) {
+    *pos++ = digits[--len];
+  }
+  return pos;
+}
+
+
+static size_t format_record(char *out, const struct timespec *ts,
+                            uint32_t node, const TelemetryRecord *rec) {
+  char *pos = put_unsigned(out, ts->tv_sec);
+  *pos++ = '.';
+  // Nanoseconds with leading zeros.
+  long nsec = ts->tv_nsec;
+  for (long div = 100000000; div > 0; div /= 10) {
+    *pos++ = '0' + (nsec / div) % 10;
+  }
+  *pos++ = ' ';
+  pos = put_unsigned(pos, node);
+  *pos++ = ' ';
+  *pos++ = telemetry_kind_char(rec->kind);
+  *pos++ = ' ';
+  if (rec->has_value) {
+    int32_t value = rec->value;
+    if (value < 0) {
+      *pos++ = '-';
+      value = -value;
+    }
+    if (rec->decimals == 2) {
+      pos = put_unsigned(pos, value / 100);
+      *pos++ = '.';
+      *pos++ = '0' + (value / 10) % 10;
+      *pos++ = '0' + value % 10;
+    } else {
+      pos = put_unsigned(pos, value);
+    }
+  } else {
+    *pos++ = '-';
+  }
+  *pos++ = ' ';
+  if (rec->status_len > 0) {
+    memcpy(pos, rec->status, rec->status_len);
+    pos += rec->status_len;
+  } else {
+    *pos++ = '-';
+  }
+  *pos++ = '\n';
+  return pos - out;
+}
+
+
+// Hand every complete line in the buffer to the parser, keep the rest.
+static void endpoint_consume(Endpoint *ep, uint32_t node,
+                             const struct timespec *ts, RecordRing *ring,
+                             Stats *stats) {
+  char *line = ep->buf;
+  char *end = ep->buf + ep->fill;
+  char *newline;
+  char record[RECORD_MAX_LEN];
+  while ((newline = memchr(line, '\n', end - line)) != NULL) {
+    size_t len = newline - line;
+    if (ep->skipping) {
+      // Tail of an overlong line.
+      ep->skipping = 0;
+    } else {
+      // The firmware ends lines with "\r\n".
+      if ((len > 0) && (line[len - 1] == '\r')) {
+        len--;
+      }
+      TelemetryRecord recs[TELEMETRY_MAX_RECORDS];
+      stats->lines++;
+      int count = telemetry_parse_line(&ep->parser, line, len, recs);
+      for (int i = 0; i < count; i++) {
+        stats->records++;
+        size_t record_len = format_record(record, ts, node, &recs[i]);
+        // A full ring gets one flush before the record is given up, write
+        // errors are reported by the flush in the main loop.
+        if (ring_used(ring) + record_len > ring->size) {
+          ring_flush(ring);
+        }
+        ring_push(ring, record, record_len);
+      }
+    }
+    line = newline + 1;
+  }
+  size_t rest = end - line;
+  if (rest == sizeof(ep->buf)) {
+    // Buffer full without a line end.
+    stats->overlong++;
+    ep->skipping = 1;
+    rest = 0;
+  }
+  memmove(ep->buf, line, rest);
+  ep->fill = rest;
+}
+
+
+// Read until the fd is drained (edge triggered).
+// Returns 0 while the endpoint is usable, 1 if it went away.
+static int endpoint_read(Endpoint *ep, uint32_t node,
+                         const struct timespec *ts, RecordRing *ring,
+                         Stats *stats) {
+  while (1) {
+    ssize_t count = read(ep->fd, ep->buf + ep->fill, sizeof(ep->buf) - ep->fill);
+    if (count > 0) {
+      stats->bytes_in += count;
+      ep->fill += count;
+      endpoint_consume(ep, node, ts, ring, stats);
+      continue;
+    }
+    if ((count < 0) && (errno == EINTR)) {
+      continue;
+    }
+    if ((count < 0) && (errno == EAGAIN)) {
+      return 0;
+    }
+    // EOF or EIO (pty master closed, USB serial unplugged).
+    return 1;
+  }
+}
+
+
+static int open_output(const char *file, const char *socket_path) {
+  if (socket_path != NULL) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    if ((fd < 0) ||
+        (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)) {
+      return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+  }
+  int fd = STDOUT_FILENO;
+  if ((file != NULL) && (strcmp(file, "-") != 0)) {
+    fd = open(file, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  }
+  // A pipe, fifo or terminal with a slow reader would block the whole loop
+  // in ring_flush, let it run into EAGAIN and the ring drop records instead.
+  // Regular files never block (and can't be polled).
+  struct stat st;
+  if ((fd >= 0) && (fstat(fd, &st) == 0) && !S_ISREG(st.st_mode)) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  }
+  return fd;
+}
+
+
+static void raise_fd_limit(void) {
+  struct rlimit lim;
+  if (getrlimit(RLIMIT_NOFILE, &lim) == 0) {
+    lim.rlim_cur = lim.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &lim);
+  }
+}
+
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options] device...\n"
+          "  -b baud     serial speed (default 9600)\n"
+          "  -o file     append records to file (default stdout)\n"
+          "  -s socket   send records to a unix stream socket instead\n"
+          "  -r bytes    output ring size, power of two (default 1 MiB)\n"
+          "  -L nodes    load test with simulated pty nodes\n"
+          "  -R rate     load test samples per second and node (default 10)\n"
+          "  -d seconds  load test duration (default 10)\n",
+          name);
+}
+
+
+int main(int argc, char **argv) {
+  unsigned long baud = 9600;
+  const char *out_file = NULL;
+  const char *out_socket = NULL;
+  size_t ring_size = 1 << 20;
+  size_t load_nodes = 0;
+  double load_rate = 10;
+  double load_duration = 10;
+  int opt;
+  while ((opt = getopt(argc, argv, "b:o:s:r:L:R:d:h")) != -1) {
+    switch (opt) {
+    case 'b':
+      baud = strtoul(optarg, NULL, 0);
+      break;
+    case 'o':
+      out_file = optarg;
+      break;
+    case 's':
+      out_socket = optarg;
+      break;
+    case 'r':
+      ring_size = strtoull(optarg, NULL, 0);
+      break;
+    case 'L':
+      load_nodes = strtoull(optarg, NULL, 0);
+      break;
+    case 'R':
+      load_rate = strtod(optarg, NULL);
+      break;
+    case 'd':
+      load_duration = strtod(optarg, NULL);
+      break;
+    default:
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  speed_t speed = baud_to_speed(baud);
+  if (speed == B0) {
+    fprintf(stderr, "unsupported baud rate %lu\n", baud);
+    return 2;
+  }
+  if ((load_nodes == 0) && (optind >= argc)) {
+    usage(argv[0]);
+    return 2;
+  }
+  raise_fd_limit();
+
+  LoadTest load_test;
+  memset(&load_test, 0, sizeof(load_test));
+  if ((load_nodes > 0) &&
+      (load_test_create(&load_test, load_nodes, load_rate) != 0)) {
+    load_test_free(&load_test);
+    return 1;
+  }
+  size_t num_endpoints = (load_nodes > 0 ? load_nodes : (size_t)(argc - optind));
+  // All buffers are allocated once, nothing is allocated per line.
+  Endpoint *endpoints = calloc(num_endpoints, sizeof(Endpoint));
+  int epfd = epoll_create1(EPOLL_CLOEXEC);
+  if ((endpoints == NULL) || (epfd < 0)) {
+    perror("setup");
+    return 1;
+  }
+  size_t open_endpoints = 0;
+  for (size_t i = 0; i < num_endpoints; i++) {
+    const char *path =
+        (load_nodes > 0 ? load_test_path(&load_test, i) : argv[optind + i]);
+    endpoints[i].fd = endpoint_open(path, speed);
+    if (endpoints[i].fd < 0) {
+      fprintf(stderr, "%s: %s\n", path, strerror(errno));
+      continue;
+    }
+    struct epoll_event ev = {.events = EPOLLIN | EPOLLET, .data.u32 = i};
+    epoll_ctl(epfd, EPOLL_CTL_ADD, endpoints[i].fd, &ev);
+    open_endpoints++;
+    if (load_nodes == 0) {
+      fprintf(stderr, "node %zu: %s\n", i, path);
+    }
+  }
+
+  int out_fd = open_output(out_file, out_socket);
+  RecordRing ring;
+  if ((out_fd < 0) || (ring_init(&ring, ring_size, out_fd) != 0)) {
+    fprintf(stderr, "output: %s\n", strerror(errno));
+    return 1;
+  }
+  // Only needed while the consumer is slower than the input.
+  uint8_t out_waiting = 0;
+
+  struct sigaction sa = {.sa_handler = handle_signal};
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if ((load_nodes > 0) && (load_test_start(&load_test) != 0)) {
+    fprintf(stderr, "load test: could not start generator\n");
+    return 1;
+  }
+
+  Stats stats = {0};
+  struct epoll_event events[EPOLL_BATCH];
+  while (running && (open_endpoints > 0)) {
+    int count = epoll_wait(epfd, events, EPOLL_BATCH, EPOLL_TIMEOUT_MS);
+    if ((count < 0) && (errno != EINTR)) {
+      perror("epoll_wait");
+      break;
+    }
+    // One timestamp per wakeup, lines of the same batch share it.
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    for (int i = 0; i < count; i++) {
+      uint32_t tag = events[i].data.u32;
+      if (tag == OUTPUT_TAG) {
+        continue;
+      }
+      Endpoint *ep = &endpoints[tag];
+      if (endpoint_read(ep, tag, &now, &ring, &stats) != 0) {
+        if (load_nodes == 0) {
+          fprintf(stderr, "node %u: closed\n", tag);
+        }
+        epoll_ctl(epfd, EPOLL_CTL_DEL, ep->fd, NULL);
+        close(ep->fd);
+        ep->fd = -1;
+        open_endpoints--;
+      }
+    }
+    ssize_t queued = ring_flush(&ring);
+    if (queued < 0) {
+      perror("output");
+      break;
+    }
+    // Wake up for the output only while data is waiting for it.
+    if ((queued > 0) != out_waiting) {
+      out_waiting = (queued > 0);
+      struct epoll_event ev = {.events = EPOLLOUT, .data.u32 = OUTPUT_TAG};
+      epoll_ctl(epfd, (out_waiting ? EPOLL_CTL_ADD : EPOLL_CTL_DEL), out_fd,
+                &ev);
+    }
+    if (load_nodes > 0) {
+      struct timespec mono;
+      clock_gettime(CLOCK_MONOTONIC, &mono);
+      double elapsed = (mono.tv_sec - start.tv_sec) +
+                       (mono.tv_nsec - start.tv_nsec) * 1e-9;
+      if (elapsed >= load_duration) {
+        load_test_stop(&load_test);
+        // Give the last lines in flight a moment to arrive.
+        if (elapsed >= load_duration + 0.5) {
+          break;
+        }
+      }
+    }
+  }
+  load_test_stop(&load_test);
+
+  // Unblock the output for the remaining records.
+  fcntl(out_fd, F_SETFL, fcntl(out_fd, F_GETFL) & ~O_NONBLOCK);
+  ring_flush(&ring);
+
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double elapsed =
+      (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+               usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+  fprintf(stderr,
+          "%.1f s: %llu lines, %llu records (%.0f/s), %llu overlong lines, "
+          "%llu records dropped by the output ring, %.1f s cpu\n",
+          elapsed, (unsigned long long)stats.lines,
+          (unsigned long long)stats.records, stats.records / elapsed,
+          (unsigned long long)stats.overlong,
+          (unsigned long long)ring.dropped, cpu);
+  if (load_nodes > 0) {
+    uint64_t expected =
+        load_test.samples_sent * LOAD_TEST_RECORDS_PER_SAMPLE +
+        load_test.banners_sent * LOAD_TEST_RECORDS_PER_BANNER;
+    fprintf(stderr,
+            "load test: %zu nodes, %llu samples sent, %llu samples dropped "
+            "at the ptys, %llu of %llu expected records received\n",
+            load_test.num_nodes, (unsigned long long)load_test.samples_sent,
+            (unsigned long long)load_test.samples_dropped,
+            (unsigned long long)stats.records, (unsigned long long)expected);
+  }
+
+  for (size_t i = 0; i < num_endpoints; i++) {
+    if (endpoints[i].fd >= 0) {
+      close(endpoints[i].fd);
+    }
+  }
+  load_test_free(&load_test);
+  ring_free(&ring);
+  free(endpoints);
+  close(epfd);
+  return 0;
+}
@@ -0,0 +1,164 @@
+#define _GNU_SOURCE
+#include "load_test.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Generator time slice.
+#define LOAD_TEST_TICK_NS 2000000L
+
+static const char banner[] = "\r\nInitialization status:\r\nINIT_SUCC\r\n"
+                             "\r\nLoading Values status:\r\nCOMP_LD_SUCC\r\n";
+
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+// Same text as the main loop of the firmware.
+static size_t format_sample(char *buf, size_t size, size_t node,
+                            uint64_t sample) {
+  unsigned temp = 1800 + (node * 7 + sample) % 900;
+  unsigned hum = 3000 + (node * 13 + sample * 3) % 4000;
+  int len = snprintf(buf, size,
+                     "\r\n\r\nTemperature read status:\r\nTEMP_LD_SUCC\r\n"
+                     "Temperature in degrees: %u.%02u °C\r\n"
+                     "\r\nHumidity read status:\r\nHUM_LD_SUCC\r\n"
+                     "Humidity in percent: %u.%02u %%\r\n",
+                     temp / 100, temp % 100, hum / 100, hum % 100);
+  return (len < 0 ? 0 : (size_t)len);
+}
+
+
+int load_test_create(LoadTest *lt, size_t num_nodes, double rate) {
+  memset(lt, 0, sizeof(*lt));
+  atomic_init(&lt->running, 0);
+  lt->rate = rate;
+  lt->master_fds = malloc(num_nodes * sizeof(int));
+  lt->slave_paths = calloc(num_nodes, LOAD_TEST_PATH_LEN);
+  if ((lt->master_fds == NULL) || (lt->slave_paths == NULL)) {
+    return 1;
+  }
+  // num_nodes only counts ptys that exist, load_test_free relies on it.
+  for (size_t i = 0; i < num_nodes; i++) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if ((fd < 0) || (grantpt(fd) != 0) || (unlockpt(fd) != 0) ||
+        (ptsname_r(fd, lt->slave_paths + i * LOAD_TEST_PATH_LEN,
+                   LOAD_TEST_PATH_LEN) != 0)) {
+      fprintf(stderr, "load test: pty %zu: %s\n", i, strerror(errno));
+      if (fd >= 0) {
+        close(fd);
+      }
+      return 2;
+    }
+    lt->master_fds[i] = fd;
+    lt->num_nodes = i + 1;
+  }
+  return 0;
+}
+
+
+// Per node progress of the generator.
+typedef struct {
+  uint64_t next_sample;
+  // Bytes of next_sample already written, 0 between samples.
+  uint16_t offset;
+} NodeProgress;
+
+
+// Write the rest of the current sample of a node.
+// Returns 1 if it went out completely, 0 if the pty is full.
+static int write_sample(LoadTest *lt, size_t node, NodeProgress *np) {
+  char buf[256];
+  size_t len = format_sample(buf, sizeof(buf), node, np->next_sample);
+  ssize_t count =
+      write(lt->master_fds[node], buf + np->offset, len - np->offset);
+  if (count > 0) {
+    np->offset += count;
+  }
+  if (np->offset < len) {
+    return 0;
+  }
+  np->offset = 0;
+  np->next_sample++;
+  lt->samples_sent++;
+  return 1;
+}
+
+
+static void *generator(void *arg) {
+  LoadTest *lt = arg;
+  NodeProgress *progress = calloc(lt->num_nodes, sizeof(NodeProgress));
+  if (progress == NULL) {
+    return NULL;
+  }
+  for (size_t i = 0; i < lt->num_nodes; i++) {
+    // The ptys are empty at this point, a short write means a broken node.
+    if (write(lt->master_fds[i], banner, sizeof(banner) - 1) ==
+        (ssize_t)(sizeof(banner) - 1)) {
+      lt->banners_sent++;
+    }
+  }
+  double start = now_seconds();
+  struct timespec tick = {0, LOAD_TEST_TICK_NS};
+  while (atomic_load(&lt->running)) {
+    double elapsed = now_seconds() - start;
+    for (size_t i = 0; i < lt->num_nodes; i++) {
+      NodeProgress *np = &progress[i];
+      // Spread the nodes over the sample period.
+      double phase = (double)i / lt->num_nodes;
+      uint64_t due = (uint64_t)(elapsed * lt->rate + phase);
+      // Finish a partially written sample first.
+      if ((np->offset > 0) && !write_sample(lt, i, np)) {
+        continue;
+      }
+      while (np->next_sample < due) {
+        if (write_sample(lt, i, np)) {
+          continue;
+        }
+        if (np->offset == 0) {
+          // Nothing of it went out, the reader fell behind. Skip it.
+          lt->samples_dropped++;
+          np->next_sample++;
+        }
+        break;
+      }
+    }
+    nanosleep(&tick, NULL);
+  }
+  free(progress);
+  return NULL;
+}
+
+
+int load_test_start(LoadTest *lt) {
+  atomic_store(&lt->running, 1);
+  return pthread_create(&lt->thread, NULL, generator, lt);
+}
+
+
+void load_test_stop(LoadTest *lt) {
+  if (atomic_load(&lt->running)) {
+    atomic_store(&lt->running, 0);
+    pthread_join(lt->thread, NULL);
+  }
+}
+
+
+void load_test_free(LoadTest *lt) {
+  for (size_t i = 0; i < lt->num_nodes; i++) {
+    close(lt->master_fds[i]);
+  }
+  free(lt->master_fds);
+  free(lt->slave_paths);
+  lt->master_fds = NULL;
+  lt->slave_paths = NULL;
+  lt->num_nodes = 0;
+}
@@ -0,0 +1,45 @@
+#ifndef LOAD_TEST_H
+#define LOAD_TEST_H
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Simulated nodes for load testing: every node is a pty whose slave side is
+// opened by the aggregator like a real serial device, while a generator
+// thread writes the firmware text format into the master side.
+typedef struct {
+  // Number of ptys created so far.
+  size_t num_nodes;
+  // Samples (temperature + humidity) per second and node.
+  double rate;
+  int *master_fds;
+  // Slave device paths, num_nodes entries of LOAD_TEST_PATH_LEN.
+  char *slave_paths;
+  pthread_t thread;
+  atomic_int running;
+  // Filled in by the generator. A sample that doesn't fit into the pty
+  // completely is finished later, only samples of which nothing was
+  // written are dropped, so the stream never contains partial samples.
+  uint64_t samples_sent;
+  uint64_t samples_dropped;
+  // Nodes whose start banner went out completely.
+  uint64_t banners_sent;
+} LoadTest;
+
+#define LOAD_TEST_PATH_LEN 32
+// Records per generated sample (temperature and humidity).
+#define LOAD_TEST_RECORDS_PER_SAMPLE 2
+// Records every node sends once at start (initialization, loading values).
+#define LOAD_TEST_RECORDS_PER_BANNER 2
+
+// Returns 0 for success.
+int load_test_create(LoadTest *lt, size_t num_nodes, double rate);
+int load_test_start(LoadTest *lt);
+void load_test_stop(LoadTest *lt);
+void load_test_free(LoadTest *lt);
+
+static inline const char *load_test_path(const LoadTest *lt, size_t node) {
+  return lt->slave_paths + node * LOAD_TEST_PATH_LEN;
+}
+#endif // LOAD_TEST_H
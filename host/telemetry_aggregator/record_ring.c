@@ -0,0 +1,78 @@
+#include "record_ring.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+
+int ring_init(RecordRing *ring, size_t size, int fd) {
+  if ((size == 0) || ((size & (size - 1)) != 0)) {
+    // Error: Size has to be a power of two!
+    return 1;
+  }
+  ring->data = malloc(size);
+  if (ring->data == NULL) {
+    return 2;
+  }
+  ring->size = size;
+  ring->head = 0;
+  ring->tail = 0;
+  ring->fd = fd;
+  ring->dropped = 0;
+  ring->written = 0;
+  return 0;
+}
+
+
+void ring_free(RecordRing *ring) {
+  free(ring->data);
+  ring->data = NULL;
+}
+
+
+int ring_push(RecordRing *ring, const char *record, size_t len) {
+  if (ring->size - ring_used(ring) < len) {
+    ring->dropped++;
+    return 1;
+  }
+  size_t start = ring->head & (ring->size - 1);
+  size_t first = ring->size - start;
+  first = (first > len ? len : first);
+  memcpy(ring->data + start, record, first);
+  memcpy(ring->data, record + first, len - first);
+  ring->head += len;
+  return 0;
+}
+
+
+ssize_t ring_flush(RecordRing *ring) {
+  while (ring_used(ring) > 0) {
+    // Queued bytes are at most two contiguous pieces.
+    size_t start = ring->tail & (ring->size - 1);
+    size_t used = ring_used(ring);
+    struct iovec iov[2];
+    int iov_count = 1;
+    iov[0].iov_base = ring->data + start;
+    iov[0].iov_len = used;
+    if (start + used > ring->size) {
+      iov[0].iov_len = ring->size - start;
+      iov[1].iov_base = ring->data;
+      iov[1].iov_len = used - iov[0].iov_len;
+      iov_count = 2;
+    }
+    ssize_t count = writev(ring->fd, iov, iov_count);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN) {
+        break;
+      }
+      return -1;
+    }
+    ring->tail += count;
+    ring->written += count;
+  }
+  return (ssize_t)ring_used(ring);
+}
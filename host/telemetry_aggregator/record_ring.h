@@ -0,0 +1,34 @@
+#ifndef RECORD_RING_H
+#define RECORD_RING_H
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// Fixed size byte ring between the parser and the output file or socket.
+// Records are appended whole or dropped, a slow consumer never blocks the
+// serial inputs.
+typedef struct {
+  char *data;
+  // Power of two.
+  size_t size;
+  // Free running positions, wrapped with size - 1 on access.
+  size_t head;
+  size_t tail;
+  int fd;
+  uint64_t dropped;
+  uint64_t written;
+} RecordRing;
+
+// Returns 0 for success.
+int ring_init(RecordRing *ring, size_t size, int fd);
+void ring_free(RecordRing *ring);
+// Returns 0 if the record was queued, 1 if it was dropped (ring full).
+int ring_push(RecordRing *ring, const char *record, size_t len);
+// Write as much as the fd takes without blocking.
+// Returns the number of bytes still queued or -1 on a write error.
+ssize_t ring_flush(RecordRing *ring);
+
+static inline size_t ring_used(const RecordRing *ring) {
+  return ring->head - ring->tail;
+}
+#endif // RECORD_RING_H
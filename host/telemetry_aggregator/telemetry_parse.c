@@ -0,0 +1,253 @@
+#include "telemetry_parse.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define PREFIX(s) s, (sizeof(s) - 1)
+
+typedef struct {
+  const char *text;
+  size_t len;
+  TelemetryKind kind;
+} LinePrefix;
+
+// Headlines announcing a status message in the next line.
+static const LinePrefix status_headlines[] = {
+    {PREFIX("Initialization status:"), TELEMETRY_INIT},
+    {PREFIX("Loading Values status:"), TELEMETRY_COMP_LOAD},
+    {PREFIX("Temperature read status:"), TELEMETRY_TEMPERATURE},
+    {PREFIX("Humidity read status:"), TELEMETRY_HUMIDITY},
+    {PREFIX("Measurement error:"), TELEMETRY_MEASURE_ERR},
+};
+
+// Lines carrying the value of the pending measurement.
+static const LinePrefix value_lines[] = {
+    {PREFIX("Temperature in degrees: "), TELEMETRY_TEMPERATURE},
+    {PREFIX("Humidity in percent: "), TELEMETRY_HUMIDITY},
+};
+
+// Lines carrying an integer value without a status headline.
+static const LinePrefix plain_lines[] = {
+    {PREFIX("Pressure raw: "), TELEMETRY_PRESSURE_RAW},
+    {PREFIX("Samples per second: "), TELEMETRY_RATE},
+    {PREFIX("R,"), TELEMETRY_RATE},
+};
+
+// Channels of a compact sample line in their order, "S,<t>,<h>,<p>".
+static const TelemetryKind compact_kinds[TELEMETRY_MAX_RECORDS] = {
+    TELEMETRY_TEMPERATURE, TELEMETRY_HUMIDITY, TELEMETRY_PRESSURE_RAW};
+static const uint8_t compact_decimals[TELEMETRY_MAX_RECORDS] = {2, 2, 0};
+
+
+static int starts_with(const char *line, size_t len, const LinePrefix *prefix) {
+  return (len >= prefix->len) && (memcmp(line, prefix->text, prefix->len) == 0);
+}
+
+
+// Parse a number written by send_float into 1/100 units. Digits beyond the
+// second decimal are cut off. Returns 1 for success.
+static int parse_centi(const char *pos, const char *end, int32_t *value) {
+  int negative = 0;
+  if ((pos < end) && (*pos == '-')) {
+    negative = 1;
+    pos++;
+  }
+  if ((pos >= end) || (*pos < '0') || (*pos > '9')) {
+    return 0;
+  }
+  int64_t whole = 0;
+  while ((pos < end) && (*pos >= '0') && (*pos <= '9')) {
+    whole = whole * 10 + (*pos - '0');
+    if (whole > INT32_MAX / 100) {
+      return 0;
+    }
+    pos++;
+  }
+  int32_t frac = 0;
+  int frac_digits = 0;
+  if ((pos < end) && (*pos == '.')) {
+    pos++;
+    while ((pos < end) && (*pos >= '0') && (*pos <= '9')) {
+      if (frac_digits < 2) {
+        frac = frac * 10 + (*pos - '0');
+        frac_digits++;
+      }
+      pos++;
+    }
+  }
+  for (; frac_digits < 2; frac_digits++) {
+    frac *= 10;
+  }
+  int32_t result = (int32_t)whole * 100 + frac;
+  *value = (negative ? -result : result);
+  return 1;
+}
+
+
+// Parse a whole field written by send_signed_decimal /
+// send_unsigned_decimal. Returns 1 for success.
+static int parse_integer(const char *pos, const char *end, int32_t *value) {
+  int negative = 0;
+  if ((pos < end) && (*pos == '-')) {
+    negative = 1;
+    pos++;
+  }
+  if (pos >= end) {
+    return 0;
+  }
+  int64_t result = 0;
+  for (; pos < end; pos++) {
+    if ((*pos < '0') || (*pos > '9')) {
+      return 0;
+    }
+    result = result * 10 + (*pos - '0');
+    if (result > INT32_MAX) {
+      return 0;
+    }
+  }
+  *value = (negative ? -result : result);
+  return 1;
+}
+
+
+static void keep_status(TelemetryParser *tp, const char *status, size_t len) {
+  tp->status_len = (len > sizeof(tp->status) ? sizeof(tp->status) : len);
+  memcpy(tp->status, status, tp->status_len);
+}
+
+
+static void set_record(TelemetryRecord *rec, TelemetryKind kind,
+                       const char *status, uint8_t status_len) {
+  rec->kind = kind;
+  rec->value = 0;
+  rec->decimals = 0;
+  rec->has_value = 0;
+  rec->status = status;
+  rec->status_len = status_len;
+}
+
+
+// Split "S,<t>,<h>,<p>" into records, empty fields are skipped channels.
+// Returns the number of records, 0 for a malformed line.
+static int parse_compact(const char *line, size_t len,
+                         TelemetryRecord recs[TELEMETRY_MAX_RECORDS]) {
+  const char *pos = line + 2;
+  const char *end = line + len;
+  int count = 0;
+  for (int field = 0; field < TELEMETRY_MAX_RECORDS; field++) {
+    const char *field_end = memchr(pos, ',', end - pos);
+    if (field == TELEMETRY_MAX_RECORDS - 1) {
+      if (field_end != NULL) {
+        return 0;
+      }
+      field_end = end;
+    } else if (field_end == NULL) {
+      return 0;
+    }
+    if (field_end > pos) {
+      TelemetryRecord *rec = &recs[count];
+      set_record(rec, compact_kinds[field], "", 0);
+      if (!parse_integer(pos, field_end, &rec->value) ||
+          ((compact_kinds[field] != TELEMETRY_TEMPERATURE) &&
+           (rec->value < 0))) {
+        return 0;
+      }
+      rec->decimals = compact_decimals[field];
+      rec->has_value = 1;
+      count++;
+    }
+    pos = field_end + 1;
+  }
+  return count;
+}
+
+
+int telemetry_parse_line(TelemetryParser *tp, const char *line, size_t len,
+                         TelemetryRecord recs[TELEMETRY_MAX_RECORDS]) {
+  TelemetryRecord *rec = &recs[0];
+  if (len == 0) {
+    return 0;
+  }
+  if (tp->expect_status) {
+    // The line right after a headline is the status message itself.
+    tp->expect_status = 0;
+    keep_status(tp, line, len);
+    if ((tp->pending == TELEMETRY_INIT) ||
+        (tp->pending == TELEMETRY_COMP_LOAD) ||
+        (tp->pending == TELEMETRY_MEASURE_ERR)) {
+      // No value follows for these.
+      set_record(rec, tp->pending, tp->status, tp->status_len);
+      tp->pending = TELEMETRY_NONE;
+      return 1;
+    }
+    return 0;
+  }
+  if ((len >= 2) && (line[0] == 'S') && (line[1] == ',')) {
+    return parse_compact(line, len, recs);
+  }
+  if ((len > 2) && (line[0] == 'E') && (line[1] == ',')) {
+    // Compact form of a failed measurement, "E,<status>".
+    keep_status(tp, line + 2, len - 2);
+    set_record(rec, TELEMETRY_MEASURE_ERR, tp->status, tp->status_len);
+    return 1;
+  }
+  for (size_t i = 0; i < sizeof(plain_lines) / sizeof(LinePrefix); i++) {
+    if (!starts_with(line, len, &plain_lines[i])) {
+      continue;
+    }
+    set_record(rec, plain_lines[i].kind, "", 0);
+    if (!parse_integer(line + plain_lines[i].len, line + len, &rec->value) ||
+        (rec->value < 0)) {
+      return 0;
+    }
+    rec->has_value = 1;
+    return 1;
+  }
+  for (size_t i = 0; i < sizeof(status_headlines) / sizeof(LinePrefix); i++) {
+    if (starts_with(line, len, &status_headlines[i])) {
+      tp->pending = status_headlines[i].kind;
+      tp->expect_status = 1;
+      return 0;
+    }
+  }
+  for (size_t i = 0; i < sizeof(value_lines) / sizeof(LinePrefix); i++) {
+    if (!starts_with(line, len, &value_lines[i])) {
+      continue;
+    }
+    if (tp->pending != value_lines[i].kind) {
+      // Value without matching headline, e.g. after a dropped line.
+      return 0;
+    }
+    tp->pending = TELEMETRY_NONE;
+    set_record(rec, value_lines[i].kind, tp->status, tp->status_len);
+    if (!parse_centi(line + value_lines[i].len, line + len, &rec->value)) {
+      return 0;
+    }
+    rec->decimals = 2;
+    rec->has_value = 1;
+    return 1;
+  }
+  return 0;
+}
+
+
+char telemetry_kind_char(TelemetryKind kind) {
+  switch (kind) {
+  case TELEMETRY_INIT:
+    return 'I';
+  case TELEMETRY_COMP_LOAD:
+    return 'C';
+  case TELEMETRY_TEMPERATURE:
+    return 'T';
+  case TELEMETRY_HUMIDITY:
+    return 'H';
+  case TELEMETRY_PRESSURE_RAW:
+    return 'P';
+  case TELEMETRY_RATE:
+    return 'R';
+  case TELEMETRY_MEASURE_ERR:
+    return 'E';
+  default:
+    return '?';
+  }
+}
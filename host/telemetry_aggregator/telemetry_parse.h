@@ -0,0 +1,61 @@
+#ifndef TELEMETRY_PARSE_H
+#define TELEMETRY_PARSE_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Parser for the text the firmware prints with send_string / send_float
+// (see src/main.c), both the text (FT) and the compact (FC) output format.
+// Works on the receive buffer in place, nothing is copied or allocated per
+// line.
+
+typedef enum {
+  TELEMETRY_NONE = 0,
+  TELEMETRY_INIT,
+  TELEMETRY_COMP_LOAD,
+  TELEMETRY_TEMPERATURE,
+  TELEMETRY_HUMIDITY,
+  // Uncompensated pressure ADC value.
+  TELEMETRY_PRESSURE_RAW,
+  // Samples per second while streaming with P0.
+  TELEMETRY_RATE,
+  // Failed measurement, sent instead of a sample, carries only a status.
+  TELEMETRY_MEASURE_ERR,
+} TelemetryKind;
+
+// A compact sample line "S,<t>,<h>,<p>" carries up to three records.
+#define TELEMETRY_MAX_RECORDS 3
+
+typedef struct {
+  TelemetryKind kind;
+  // Value in 1/10^decimals of its unit, only valid if has_value is set.
+  // Temperature (°C) and humidity (%RH) have 2 decimals, raw pressure and
+  // rate 0.
+  int32_t value;
+  uint8_t decimals;
+  uint8_t has_value;
+  // Status message of the record, points into the parser. Empty for
+  // records the firmware sends without a status (compact format, pressure
+  // and rate).
+  const char *status;
+  uint8_t status_len;
+} TelemetryRecord;
+
+// Per node parser state, zero initialized is a valid start state.
+typedef struct {
+  // Kind announced by the last "... status:" line.
+  TelemetryKind pending;
+  // Set while the status message line is still to come.
+  uint8_t expect_status;
+  uint8_t status_len;
+  // Same size as TransmitStatus.status_msg.
+  char status[16];
+} TelemetryParser;
+
+// Feed a single line without the line ending.
+// Returns the number of complete records written to recs (0 to
+// TELEMETRY_MAX_RECORDS).
+int telemetry_parse_line(TelemetryParser *tp, const char *line, size_t len,
+                         TelemetryRecord recs[TELEMETRY_MAX_RECORDS]);
+// Short name of a record kind used in the output.
+char telemetry_kind_char(TelemetryKind kind);
+#endif // TELEMETRY_PARSE_H
@@ -0,0 +1,125 @@
+#include "telemetry_parse.h"
+#include <stdio.h>
+#include <string.h>
+
+// Feeds firmware output (src/main.c) through telemetry_parse_line and
+// checks the records. Run with `make test`.
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+
+static int feed(TelemetryParser *tp, const char *line,
+                TelemetryRecord recs[TELEMETRY_MAX_RECORDS]) {
+  return telemetry_parse_line(tp, line, strlen(line), recs);
+}
+
+
+static int status_is(const TelemetryRecord *rec, const char *status) {
+  return (rec->status_len == strlen(status)) &&
+         (memcmp(rec->status, status, rec->status_len) == 0);
+}
+
+
+static void test_text_format(void) {
+  TelemetryParser tp = {0};
+  TelemetryRecord recs[TELEMETRY_MAX_RECORDS];
+  CHECK(feed(&tp, "Initialization status:", recs) == 0);
+  CHECK(feed(&tp, "INIT_SUCC", recs) == 1);
+  CHECK(recs[0].kind == TELEMETRY_INIT);
+  CHECK(!recs[0].has_value);
+  CHECK(status_is(&recs[0], "INIT_SUCC"));
+
+  CHECK(feed(&tp, "Temperature read status:", recs) == 0);
+  CHECK(feed(&tp, "DATA_LD_SUCC", recs) == 0);
+  CHECK(feed(&tp, "Temperature in degrees: -12.34 °C", recs) == 1);
+  CHECK(recs[0].kind == TELEMETRY_TEMPERATURE);
+  CHECK(recs[0].has_value && (recs[0].value == -1234));
+  CHECK(recs[0].decimals == 2);
+  CHECK(status_is(&recs[0], "DATA_LD_SUCC"));
+
+  CHECK(feed(&tp, "Humidity read status:", recs) == 0);
+  CHECK(feed(&tp, "DATA_LD_SUCC", recs) == 0);
+  CHECK(feed(&tp, "Humidity in percent: 45.6 %", recs) == 1);
+  CHECK(recs[0].kind == TELEMETRY_HUMIDITY);
+  CHECK(recs[0].value == 4560);
+
+  CHECK(feed(&tp, "Pressure raw: 415148", recs) == 1);
+  CHECK(recs[0].kind == TELEMETRY_PRESSURE_RAW);
+  CHECK(recs[0].has_value && (recs[0].value == 415148));
+  CHECK(recs[0].decimals == 0);
+  CHECK(recs[0].status_len == 0);
+
+  CHECK(feed(&tp, "Samples per second: 162", recs) == 1);
+  CHECK(recs[0].kind == TELEMETRY_RATE);
+  CHECK(recs[0].value == 162);
+
+  CHECK(feed(&tp, "Measurement error:", recs) == 0);
+  CHECK(feed(&tp, "DATA_LD_ERR", recs) == 1);
+  CHECK(recs[0].kind == TELEMETRY_MEASURE_ERR);
+  CHECK(!recs[0].has_value);
+  CHECK(status_is(&recs[0], "DATA_LD_ERR"));
+
+  // Value without its headline, e.g. after a dropped line.
+  CHECK(feed(&tp, "Humidity in percent: 45.60 %", recs) == 0);
+  CHECK(feed(&tp, "Pressure raw: 41x", recs) == 0);
+}
+
+
+static void test_compact_format(void) {
+  TelemetryParser tp = {0};
+  TelemetryRecord recs[TELEMETRY_MAX_RECORDS];
+  CHECK(feed(&tp, "S,2315,4617,415148", recs) == 3);
+  CHECK(recs[0].kind == TELEMETRY_TEMPERATURE);
+  CHECK((recs[0].value == 2315) && (recs[0].decimals == 2));
+  CHECK(recs[1].kind == TELEMETRY_HUMIDITY);
+  CHECK((recs[1].value == 4617) && (recs[1].decimals == 2));
+  CHECK(recs[2].kind == TELEMETRY_PRESSURE_RAW);
+  CHECK((recs[2].value == 415148) && (recs[2].decimals == 0));
+  for (int i = 0; i < 3; i++) {
+    CHECK(recs[i].has_value && (recs[i].status_len == 0));
+  }
+
+  // Skipped channels stay empty (STREAM_PROFILE default: no pressure).
+  CHECK(feed(&tp, "S,-505,3001,", recs) == 2);
+  CHECK((recs[0].kind == TELEMETRY_TEMPERATURE) && (recs[0].value == -505));
+  CHECK((recs[1].kind == TELEMETRY_HUMIDITY) && (recs[1].value == 3001));
+  CHECK(feed(&tp, "S,,,415148", recs) == 1);
+  CHECK(recs[0].kind == TELEMETRY_PRESSURE_RAW);
+  CHECK(feed(&tp, "S,,,", recs) == 0);
+
+  CHECK(feed(&tp, "R,1650", recs) == 1);
+  CHECK((recs[0].kind == TELEMETRY_RATE) && (recs[0].value == 1650));
+
+  CHECK(feed(&tp, "E,START_MEAS_ERR", recs) == 1);
+  CHECK(recs[0].kind == TELEMETRY_MEASURE_ERR);
+  CHECK(!recs[0].has_value);
+  CHECK(status_is(&recs[0], "START_MEAS_ERR"));
+
+  // Malformed lines, e.g. cut by a dropped byte.
+  CHECK(feed(&tp, "S,2315,4617", recs) == 0);
+  CHECK(feed(&tp, "S,2315,4617,1,2", recs) == 0);
+  CHECK(feed(&tp, "S,23a5,4617,415148", recs) == 0);
+  CHECK(feed(&tp, "S,2315,-4617,415148", recs) == 0);
+  CHECK(feed(&tp, "R,", recs) == 0);
+  CHECK(feed(&tp, "R,-3", recs) == 0);
+}
+
+
+int main(void) {
+  test_text_format();
+  test_compact_format();
+  if (failures != 0) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("telemetry_parse: all checks passed\n");
+  return 0;
+}
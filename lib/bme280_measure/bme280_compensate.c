@@ -0,0 +1,22 @@
+#include "bme280_compensate.h"
+#include "bme280_measure.h"
+#include <stdint.h>
+
+
+// Compensation Function for raw temperature readings.
+// Stores t_fine within the constants for a following compensate_hum call.
+// raw_temp: int32_t containing the raw temperature data of the sensor.
+int32_t compensate_temp(uint32_t raw_temp, SensorConstants *scp) {
+  scp->t_fine = bme_calc_t_fine(raw_temp, scp);
+  return bme_calc_temp(scp->t_fine);
+}
+
+
+// Compensation Function for raw humidity readings.
+// raw_hum: uint32_t containing the raw humidity data of the sensor.
+// Returns humidity in %RH as unsigned 32 bit integer in Q22.10 format (22
+// integer and 10 fractional bits). Output value of “47445” represents
+// 47445/1024 = 46.333 %RH
+uint32_t compensate_hum(uint32_t raw_hum, SensorConstants *scp) {
+  return bme_calc_hum(raw_hum, scp->t_fine, scp);
+}
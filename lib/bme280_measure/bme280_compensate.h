@@ -0,0 +1,70 @@
+#ifndef BME280_COMPENSATE_H
+#define BME280_COMPENSATE_H
+#include "bme280_measure.h"
+#include <stdint.h>
+
+// Integer compensation math shared by the firmware (compensate_temp,
+// compensate_hum) and the host side batch library. Keep it free of any AVR
+// headers and don't change an expression here without checking the results
+// of both builds against each other.
+
+#define BME280_TEMP_MIN (-4000)
+#define BME280_TEMP_MAX 8500
+#define BME280_HUM_MAX 419430400
+
+// Fine resolution temperature, input for the humidity compensation.
+// The ADC value is taken as signed like in the datasheet, with uint32_t the
+// differences below would wrap and shift in zeros instead of the sign for
+// a negative dig_T3 or temperatures below 0 °C.
+static inline int32_t bme_calc_t_fine(uint32_t raw_temp,
+                                      const SensorConstants *scp) {
+  int32_t adc_temp = (int32_t)raw_temp;
+  int32_t var1, var2;
+  var1 = ((((adc_temp >> 3) - ((int32_t)scp->dig_T1 << 1))) *
+          ((int32_t)scp->dig_T2)) >>
+         11;
+  var2 = (((((adc_temp >> 4) - ((int32_t)scp->dig_T1)) *
+            ((adc_temp >> 4) - ((int32_t)scp->dig_T1))) >>
+           12) *
+          ((int32_t)scp->dig_T3)) >>
+         14;
+  return var1 + var2;
+}
+
+// Temperature in 0.01 degrees, clamped to the operating range.
+static inline int32_t bme_calc_temp(int32_t t_fine) {
+  int32_t temperature = (t_fine * 5 + 128) >> 8;
+  temperature = (temperature < BME280_TEMP_MIN ? BME280_TEMP_MIN : temperature);
+  temperature = (temperature > BME280_TEMP_MAX ? BME280_TEMP_MAX : temperature);
+  return temperature;
+}
+
+// Humidity in Q22.10 %RH, t_fine has to come from the same sample.
+static inline uint32_t bme_calc_hum(uint32_t raw_hum, int32_t t_fine,
+                                    const SensorConstants *scp) {
+  // Signed for the same reason as in bme_calc_t_fine.
+  int32_t adc_hum = (int32_t)raw_hum;
+  int32_t hum_buffer;
+  hum_buffer = (t_fine - ((int32_t)76800));
+  hum_buffer = (((((adc_hum << 14) - (((int32_t)scp->dig_H4) << 20) -
+                   (((int32_t)scp->dig_H5) * hum_buffer)) +
+                  ((int32_t)16384)) >>
+                 15) *
+                (((((((hum_buffer * ((int32_t)scp->dig_H6)) >> 10) *
+                     (((hum_buffer * ((int32_t)scp->dig_H3)) >> 11) +
+                      ((int32_t)32768))) >>
+                    10) +
+                   ((int32_t)2097152)) *
+                      ((int32_t)scp->dig_H2) +
+                  8192) >>
+                 14));
+  hum_buffer =
+      (hum_buffer - (((((hum_buffer >> 15) * (hum_buffer >> 15)) >> 7) *
+                      ((int32_t)scp->dig_H1)) >>
+                     4));
+  hum_buffer = (hum_buffer < 0 ? 0 : hum_buffer);
+  hum_buffer = (hum_buffer > BME280_HUM_MAX ? BME280_HUM_MAX : hum_buffer);
+  return (uint32_t)(hum_buffer >> 12);
+}
+
+#endif // BME280_COMPENSATE_H
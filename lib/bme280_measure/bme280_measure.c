@@ -1,90 +1,96 @@
 #include "bme280_measure.h"
 #include "i2c_transmission.h"
+#include "spi_transmission.h"
 // #include "uart_transmission.h"
 #include "util/delay.h"
 #include <stdint.h>
 #include <string.h>
 
 
-// Compensation Function for raw temperature readings.
-// raw_temp: int32_t containing the raw temperature data of the sensor.
-int32_t compensate_temp(uint32_t raw_temp, SensorConstants *scp) {
-  int32_t var1, var2, temperature;
-  int32_t temperature_min = -4000;
-  int32_t temperature_max = 8500;
-  var1 = ((((raw_temp >> 3) - ((int32_t)scp->dig_T1 << 1))) *
-          ((int32_t)scp->dig_T2)) >>
-         11;
-  var2 = (((((raw_temp >> 4) - ((int32_t)scp->dig_T1)) *
-            ((raw_temp >> 4) - ((int32_t)scp->dig_T1))) >>
-           12) *
-          ((int32_t)scp->dig_T3)) >>
-         14;
-  scp->t_fine = var1 + var2;
-  temperature = (scp->t_fine * 5 + 128) >> 8;
-  if (temperature < temperature_min) {
-    temperature = temperature_min;
-  } else if (temperature > temperature_max) {
-    temperature = temperature_max;
+// Bus implementation for I2C, bus_id is the slave address.
+static uint8_t i2c_read_regs(const BmeDevice *dev, uint8_t reg,
+                             uint8_t *storage, uint8_t num_bytes) {
+  uint8_t check_status = master_transmit_read_reg(dev->bus_id, reg);
+  if (check_status != 0) {
+    return check_status;
   }
-  return temperature;
+  return master_receive_nbytes(dev->bus_id, storage, num_bytes);
 }
 
 
-// Compensation Function for raw humidity readings.
-// raw_hum: uint32_t containing the raw humidity data of the sensor.
-// Returns humidity in %RH as unsigned 32 bit integer in Q22.10 format (22
-// integer and 10 fractional bits). Output value of “47445” represents
-// 47445/1024 = 46.333 %RH
-uint32_t compensate_hum(uint32_t raw_hum, SensorConstants *scp) {
-  int32_t hum_buffer;
-  hum_buffer = (scp->t_fine - ((int32_t)76800));
-  hum_buffer = (((((raw_hum << 14) - (((int32_t)scp->dig_H4) << 20) -
-                   (((int32_t)scp->dig_H5) * hum_buffer)) +
-                  ((int32_t)16384)) >>
-                 15) *
-                (((((((hum_buffer * ((int32_t)scp->dig_H6)) >> 10) *
-                     (((hum_buffer * ((int32_t)scp->dig_H3)) >> 11) +
-                      ((int32_t)32768))) >>
-                    10) +
-                   ((int32_t)2097152)) *
-                      ((int32_t)scp->dig_H2) +
-                  8192) >>
-                 14));
-  hum_buffer =
-      (hum_buffer - (((((hum_buffer >> 15) * (hum_buffer >> 15)) >> 7) *
-                      ((int32_t)scp->dig_H1)) >>
-                     4));
-  hum_buffer = (hum_buffer < 0 ? 0 : hum_buffer);
-  hum_buffer = (hum_buffer > 419430400 ? 419430400 : hum_buffer);
-  return (uint32_t)(hum_buffer >> 12);
+static uint8_t i2c_write_reg(const BmeDevice *dev, uint8_t reg,
+                             uint8_t value) {
+  return master_transmit_write_to_reg(dev->bus_id, reg, value);
 }
 
 
-// Initialize the sensor, will apply a soft reset and deactivate filters.
-// tsp: Pointer to transmission status codes.
-void bme_init(TransmitStatus *tsp) {
-  uint8_t check_status =
-      master_transmit_read_reg(BME280_ADDRESS_GND, BME280_CHIP_ID_REG);
+static const BmeBus bme_i2c_bus = {i2c_read_regs, i2c_write_reg};
+
+
+// Bus implementation for SPI, bus_id is the chip select pin.
+// The sensor auto increments the address on reads, so a whole burst needs
+// only one address byte.
+static uint8_t spi_read_regs(const BmeDevice *dev, uint8_t reg,
+                             uint8_t *storage, uint8_t num_bytes) {
+  return spi_read_nbytes(dev->bus_id, reg | BME280_SPI_READ, storage,
+                         num_bytes);
+}
+
+
+static uint8_t spi_write_reg(const BmeDevice *dev, uint8_t reg,
+                             uint8_t value) {
+  return spi_write_to_reg(dev->bus_id, reg & BME280_SPI_WRITE_MASK, value);
+}
+
+
+static const BmeBus bme_spi_bus = {spi_read_regs, spi_write_reg};
+
+
+// Create a handle for a sensor connected via I2C.
+// dev: Pointer to the handle to fill in.
+// address: BME280_ADDRESS_GND or BME280_ADDRESS_VCC depending on SDO.
+void bme_create_i2c_device(BmeDevice *dev, uint8_t address) {
+  dev->bus = &bme_i2c_bus;
+  dev->bus_id = address;
+}
+
+
+// Create a handle for a sensor connected via SPI.
+// Returns 0 for success, 1 if the pin can't be used as chip select.
+// dev: Pointer to the handle to fill in.
+// cs_pin: Chip select pin on port B, e.g. BME280_SPI_CS_PIN.
+uint8_t bme_create_spi_device(BmeDevice *dev, uint8_t cs_pin) {
+  uint8_t check_status = spi_init_cs(cs_pin);
   if (check_status != 0) {
-    strcpy(tsp->status_msg, "ID_REG_ERR");
-    return;
+    return check_status;
   }
+  dev->bus = &bme_spi_bus;
+  dev->bus_id = cs_pin;
+  return 0;
+}
+
+
+// Initialize the sensor, will apply a soft reset and deactivate filters.
+// dev: Pointer to the device handle.
+// tsp: Pointer to transmission status codes.
+void bme_init(const BmeDevice *dev, TransmitStatus *tsp) {
   uint8_t returned_id = 0;
-  check_status = master_receive_byte(BME280_ADDRESS_GND, &returned_id);
+  uint8_t check_status =
+      dev->bus->read_regs(dev, BME280_CHIP_ID_REG, &returned_id, 1);
   if ((check_status != 0) || (returned_id != BME280_CHIP_ID)) {
     strcpy(tsp->status_msg, "ID_READ_ERR");
     return;
   }
-  check_status = master_transmit_write_to_reg(
-      BME280_ADDRESS_GND, BME280_RESET_REG, BME280_RESET_VAL);
-  if ((check_status != 0) || (returned_id != BME280_CHIP_ID)) {
+  check_status =
+      dev->bus->write_reg(dev, BME280_RESET_REG, BME280_RESET_VAL);
+  if (check_status != 0) {
     strcpy(tsp->status_msg, "RESET_ERR");
     return;
   }
-  check_status =
-      master_transmit_write_to_reg(BME280_ADDRESS_GND, BME280_CONFIG_REG, 0x00);
-  if ((check_status != 0) || (returned_id != BME280_CHIP_ID)) {
+  // Start-up time after reset is 2 ms.
+  _delay_ms(2);
+  check_status = dev->bus->write_reg(dev, BME280_CONFIG_REG, 0x00);
+  if (check_status != 0) {
     strcpy(tsp->status_msg, "CONFIG_ERR");
     return;
   }
@@ -94,18 +100,14 @@ void bme_init(TransmitStatus *tsp) {
 
 
 // Function to load compensation values stored within the sensor.
+// dev: Pointer to the device handle.
 // scp: Pointer to buffer in which the constants should be stored.
 // tsp: Pointer to transmission status codes.
-void bme_load_comp_vals(SensorConstants *scp, TransmitStatus *tsp) {
+void bme_load_comp_vals(const BmeDevice *dev, SensorConstants *scp,
+                        TransmitStatus *tsp) {
   uint8_t comp_buffer[BME280_COMPENSATE_REG_1_LEN];
-  uint8_t check_status =
-      master_transmit_read_reg(BME280_ADDRESS_GND, BME280_COMPENSATE_REG_1);
-  if (check_status != 0) {
-    strcpy(tsp->status_msg, "COMP1_REG_ERR");
-    return;
-  }
-  check_status = master_receive_nbytes(BME280_ADDRESS_GND, comp_buffer,
-                                       sizeof(comp_buffer));
+  uint8_t check_status = dev->bus->read_regs(dev, BME280_COMPENSATE_REG_1,
+                                             comp_buffer, sizeof(comp_buffer));
   if (check_status != 0) {
     strcpy(tsp->status_msg, "COMP1_LD_ERR");
     return;
@@ -127,14 +129,8 @@ void bme_load_comp_vals(SensorConstants *scp, TransmitStatus *tsp) {
   // only the first humidity constant in this buffer
   scp->dig_H1 = comp_buffer[25];
   // start reading of second part of variables
-  check_status =
-      master_transmit_read_reg(BME280_ADDRESS_GND, BME280_COMPENSATE_REG_2);
-  if (check_status != 0) {
-    strcpy(tsp->status_msg, "COMP2_REG_ERR");
-    return;
-  }
-  check_status = master_receive_nbytes(BME280_ADDRESS_GND, comp_buffer,
-                                       BME280_COMPENSATE_REG_2_LEN);
+  check_status = dev->bus->read_regs(dev, BME280_COMPENSATE_REG_2, comp_buffer,
+                                     BME280_COMPENSATE_REG_2_LEN);
   if (check_status != 0) {
     strcpy(tsp->status_msg, "COMP2_LD_ERR");
     return;
@@ -149,6 +145,34 @@ void bme_load_comp_vals(SensorConstants *scp, TransmitStatus *tsp) {
 }
 
 
+// Read the last measured raw values of all channels in a single burst.
+// Doesn't start a measurement, channels that were skipped read 0x80000
+// (0x8000 for humidity).
+// dev: Pointer to the device handle.
+// rdp: Pointer to buffer in which the raw values should be stored.
+// tsp: Pointer to transmission status codes.
+// Returns 0 for success, the bus status otherwise (rdp is left untouched).
+uint8_t bme_read_raw_data(const BmeDevice *dev, RawData *rdp,
+                          TransmitStatus *tsp) {
+  uint8_t data_buf[BME280_DATA_LEN] = {};
+  uint8_t check_status =
+      dev->bus->read_regs(dev, BME280_DATA_REG, data_buf, BME280_DATA_LEN);
+  if (check_status != 0) {
+    strcpy(tsp->status_msg, "DATA_LD_ERR");
+    return check_status;
+  }
+  // Pressure and temperature: 1. msb; 2. lsb; 3. xlsb 7-4
+  rdp->pressure_raw = ((uint32_t)data_buf[0] << 12) |
+                      ((uint32_t)data_buf[1] << 4) | (data_buf[2] >> 4);
+  rdp->temperature_raw = ((uint32_t)data_buf[3] << 12) |
+                         ((uint32_t)data_buf[4] << 4) | (data_buf[5] >> 4);
+  // Humidity: 1. msb; 2. lsb
+  rdp->humidity_raw = ((uint16_t)data_buf[6] << 8) | data_buf[7];
+  strcpy(tsp->status_msg, "DATA_LD_SUCC");
+  return 0;
+}
+
+
 // Local function to determine the basic oversampling rate
 uint8_t determine_general_ovs(uint8_t oversampling) {
   uint8_t choose_os;
@@ -177,88 +201,224 @@ uint8_t determine_general_ovs(uint8_t oversampling) {
   return choose_os;
 }
 
-// Local function to delay the device as long as the measurement takes.
-// Since the _delay_ms() function needs a fixed value at compile time,
-// three worst case alternatives are made.
-// TODO: Find a more elegant solution, e.g. with timers.
-void worst_case_delay(uint8_t ovs_t, uint8_t ovs_p, uint8_t ovs_h) {
-  uint8_t state_machine = 0;
-  uint8_t bit_1 = ovs_t != 0 ? 1 : 0;
-  uint8_t bit_2 = ovs_p != 0 ? 1 : 0;
-  uint8_t bit_3 = ovs_h != 0 ? 1 : 0;
-  // States representing if an oversampling value is given, hence a
-  // measurement will be done or not.
-  state_machine = bit_1 + bit_2 + bit_3;
-  // send_string("\n\rDEBUG!\n\r");
-  // send_unsigned_decimal(state_machine);
-  // send_string("\n\rDEBUG!\n\r");
-  switch (state_machine) {
-  case 0:
-    break;
-  case 1:
-    _delay_ms(80);
-    break;
-  case 2:
-    _delay_ms(160);
-    break;
-  case 3:
-    _delay_ms(240);
-    break;
+// Local function to get the maximum measurement time in us (datasheet 9.1).
+// Skipped channels (oversampling 0) don't add to the time.
+uint32_t max_measurement_time_us(uint8_t ovs_t, uint8_t ovs_p, uint8_t ovs_h) {
+  // Register value n > 0 means 2^(n - 1) times oversampling.
+  uint8_t reg_t = determine_general_ovs(ovs_t);
+  uint8_t reg_p = determine_general_ovs(ovs_p);
+  uint8_t reg_h = determine_general_ovs(ovs_h);
+  uint32_t time_us = 1250;
+  if (reg_t != 0) {
+    time_us += 2300UL << (reg_t - 1);
+  }
+  if (reg_p != 0) {
+    time_us += (2300UL << (reg_p - 1)) + 575;
+  }
+  if (reg_h != 0) {
+    time_us += (2300UL << (reg_h - 1)) + 575;
+  }
+  return time_us;
+}
+
+
+// Local function to get the standby time of normal mode in us.
+uint32_t standby_time_us(uint8_t standby) {
+  switch (standby) {
+  case BME280_STANDBY_0_5_MS:
+    return 500;
+  case BME280_STANDBY_62_5_MS:
+    return 62500;
+  case BME280_STANDBY_125_MS:
+    return 125000;
+  case BME280_STANDBY_250_MS:
+    return 250000;
+  case BME280_STANDBY_500_MS:
+    return 500000;
+  case BME280_STANDBY_10_MS:
+    return 10000;
+  case BME280_STANDBY_20_MS:
+    return 20000;
   default:
-    break;
+    return 1000000;
   }
 }
 
 
-// Local function to transmit start of measurement and provide enough
-// delay for the measurement to complete.
-uint8_t start_measurement(uint8_t ovs_t, uint8_t ovs_p, uint8_t ovs_h,
-                          TransmitStatus *tsp) {
+// Local function to poll the status register until a running conversion
+// has finished. Bus time comes on top of the counted time.
+// timeout_us: Give up after this long, done stays 0 then.
+// done: Set to 1 once a conversion was seen running and then finished.
+// Returns 0 for success, the bus status if the register can't be read.
+uint8_t poll_conversion_done(const BmeDevice *dev, uint32_t timeout_us,
+                             uint8_t *done) {
+  uint8_t seen_measuring = 0;
+  *done = 0;
+  // _delay_us() needs a value known at compile time, so wait in steps.
+  for (uint32_t waited = 0; waited < timeout_us; waited += 50) {
+    uint8_t status = 0;
+    uint8_t check_status =
+        dev->bus->read_regs(dev, BME280_STATUS_REG, &status, 1);
+    if (check_status != 0) {
+      return check_status;
+    }
+    if (status & BME280_STATUS_MEASURING) {
+      seen_measuring = 1;
+    } else if (seen_measuring) {
+      *done = 1;
+      return 0;
+    }
+    _delay_us(50);
+  }
+  return 0;
+}
+
+
+// Local function to transmit start of measurement and wait for the
+// measurement to complete.
+uint8_t start_measurement(const BmeDevice *dev, uint8_t ovs_t, uint8_t ovs_p,
+                          uint8_t ovs_h, TransmitStatus *tsp) {
   uint8_t ovs_h_reg_val = determine_general_ovs(ovs_h);
-  uint8_t check_status = master_transmit_write_to_reg(
-      BME280_ADDRESS_GND, BME280_CONTROL_HUM_REG, ovs_h_reg_val);
+  uint8_t check_status =
+      dev->bus->write_reg(dev, BME280_CONTROL_HUM_REG, ovs_h_reg_val);
   // Worst case time taken for the measurement.
   if (check_status != 0) {
     strcpy(tsp->status_msg, "OVS_H_REG_ERR");
     return check_status;
   }
   uint8_t ovs_t_reg_val = determine_general_ovs(ovs_t);
-  uint8_t ovs_p_reg_val = determine_general_ovs(ovs_h);
+  uint8_t ovs_p_reg_val = determine_general_ovs(ovs_p);
   uint8_t ctrl_reg_val =
       (ovs_t_reg_val << 5) | (ovs_p_reg_val << 2) | BME280_FORCE_MEAS;
-  check_status = master_transmit_write_to_reg(
-      BME280_ADDRESS_GND, BME280_CONTROL_MEAS_REG, ctrl_reg_val);
+  check_status = dev->bus->write_reg(dev, BME280_CONTROL_MEAS_REG, ctrl_reg_val);
   if (check_status != 0) {
     strcpy(tsp->status_msg, "START_MEAS_ERR");
     return check_status;
   }
-  // Max Value here is about 120 ms so uint8_t is enough.
-  worst_case_delay(ovs_t, ovs_p, ovs_h);
+  // Poll instead of always waiting the worst case, so back to back forced
+  // measurements run at the rate the sensor delivers. The worst case (max
+  // about 113 ms, 16x oversampling on all channels) is the timeout, the
+  // result is complete after it even if the busy phase was missed.
+  uint8_t done;
+  check_status = poll_conversion_done(
+      dev, max_measurement_time_us(ovs_t, ovs_p, ovs_h), &done);
+  if (check_status != 0) {
+    strcpy(tsp->status_msg, "STATUS_LD_ERR");
+    return check_status;
+  }
+  return 0;
+}
+
+
+// Apply oversampling, mode and standby time of a measurement configuration.
+// In normal mode the sensor starts measuring right away.
+// dev: Pointer to the device handle.
+// mcp: Pointer to the measurement configuration.
+// tsp: Pointer to transmission status codes.
+void bme_configure(const BmeDevice *dev, const MeasureConfig *mcp,
+                   TransmitStatus *tsp) {
+  // The config register is only written reliably in sleep mode.
+  uint8_t check_status =
+      dev->bus->write_reg(dev, BME280_CONTROL_MEAS_REG, BME280_SLEEP);
+  if (check_status != 0) {
+    strcpy(tsp->status_msg, "SLEEP_ERR");
+    return;
+  }
+  // Filter stays off.
+  check_status = dev->bus->write_reg(dev, BME280_CONFIG_REG,
+                                     (mcp->standby & 0b111) << 5);
+  if (check_status != 0) {
+    strcpy(tsp->status_msg, "CONFIG_ERR");
+    return;
+  }
+  check_status = dev->bus->write_reg(dev, BME280_CONTROL_HUM_REG,
+                                     determine_general_ovs(mcp->ovs_h));
+  if (check_status != 0) {
+    strcpy(tsp->status_msg, "OVS_H_REG_ERR");
+    return;
+  }
+  // Forced mode measurements are started by bme_measure.
+  if (mcp->mode == BME280_CYCLE_MEAS) {
+    uint8_t ctrl_reg_val = (determine_general_ovs(mcp->ovs_t) << 5) |
+                           (determine_general_ovs(mcp->ovs_p) << 2) |
+                           BME280_CYCLE_MEAS;
+    check_status = dev->bus->write_reg(dev, BME280_CONTROL_MEAS_REG,
+                                       ctrl_reg_val);
+    if (check_status != 0) {
+      strcpy(tsp->status_msg, "START_MEAS_ERR");
+      return;
+    }
+  }
+  strcpy(tsp->status_msg, "CONFIG_SUCC");
+}
+
+
+// Get a raw sample of all channels enabled in the configuration.
+// Forced mode triggers a measurement and waits for it, normal mode returns
+// the latest completed measurement without waiting.
+// dev: Pointer to the device handle.
+// mcp: Pointer to the configuration passed to bme_configure before.
+// rdp: Pointer to buffer in which the raw values should be stored.
+// tsp: Pointer to transmission status codes.
+// Returns 0 for success, the bus status otherwise (rdp is left untouched).
+uint8_t bme_measure(const BmeDevice *dev, const MeasureConfig *mcp,
+                    RawData *rdp, TransmitStatus *tsp) {
+  if (mcp->mode == BME280_FORCE_MEAS) {
+    uint8_t check_status = start_measurement(dev, mcp->ovs_t, mcp->ovs_p,
+                                             mcp->ovs_h, tsp);
+    if (check_status != 0) {
+      return check_status;
+    }
+  }
+  return bme_read_raw_data(dev, rdp, tsp);
+}
+
+
+// Wait until the sensor completed a new measurement in normal mode, so
+// consecutive bme_measure calls never return the same sample twice.
+// dev: Pointer to the device handle.
+// mcp: Pointer to the configuration passed to bme_configure before.
+// tsp: Pointer to transmission status codes.
+// Returns 0 once new data is ready, 1 on timeout, the bus status otherwise.
+uint8_t bme_wait_new_data(const BmeDevice *dev, const MeasureConfig *mcp,
+                          TransmitStatus *tsp) {
+  // One full cycle plus margin, bus time comes on top of the counted time.
+  uint32_t timeout_us = 2 * (max_measurement_time_us(mcp->ovs_t, mcp->ovs_p,
+                                                     mcp->ovs_h) +
+                             standby_time_us(mcp->standby));
+  // A new result is ready once a running conversion has finished.
+  uint8_t done;
+  uint8_t check_status = poll_conversion_done(dev, timeout_us, &done);
+  if (check_status != 0) {
+    strcpy(tsp->status_msg, "STATUS_LD_ERR");
+    return check_status;
+  }
+  if (!done) {
+    strcpy(tsp->status_msg, "WAIT_TIMEOUT");
+    return 1;
+  }
+  strcpy(tsp->status_msg, "NEW_DATA");
   return 0;
 }
 
 
 // Get the raw temperature value.
+// dev: Pointer to the device handle.
 // oversampling: Choose temperature oversempling.
 //  Valid values are 1, 2, 4, 8 and 16 other values result in oversampling = 1.
 // tsp: Pointer to transmission status codes.
-uint32_t bme_get_temp_raw(uint8_t oversampling, TransmitStatus *tsp) {
+uint32_t bme_get_temp_raw(const BmeDevice *dev, uint8_t oversampling,
+                          TransmitStatus *tsp) {
   // Start the measurement but only for temperature.
-  uint8_t check_status = start_measurement(oversampling, 0, 0, tsp);
+  uint8_t check_status = start_measurement(dev, oversampling, 0, 0, tsp);
   if (check_status != 0) {
     return check_status;
   }
-  // Prepare to read measured data from register.
-  check_status = master_transmit_read_reg(BME280_ADDRESS_GND, BME280_TEMP_REG);
-  if (check_status != 0) {
-    strcpy(tsp->status_msg, "TEMP_REG_ERR");
-    return check_status;
-  }
   // Create buffer to store the temperature value.
   uint8_t temp_data_buf[BME280_TEMP_LEN] = {};
   uint32_t raw_temp = 0;
   check_status =
-      master_receive_nbytes(BME280_ADDRESS_GND, temp_data_buf, BME280_TEMP_LEN);
+      dev->bus->read_regs(dev, BME280_TEMP_REG, temp_data_buf, BME280_TEMP_LEN);
   if (check_status != 0) {
     strcpy(tsp->status_msg, "TEMP_LD_ERR");
     return check_status;
@@ -272,13 +432,14 @@ uint32_t bme_get_temp_raw(uint8_t oversampling, TransmitStatus *tsp) {
 
 
 // Returns the raw measured temperature in degrees.
+// dev: Pointer to the device handle.
 // scp: Pointer to sensor constants.
 // oversampling: Choose temperature oversempling.
 //  Valid values are 1, 2, 4, 8 and 16 other values result in oversampling = 1.
 // tsp: Pointer to transmission status codes.
-float bme_get_temp_degrees(SensorConstants *scp, uint8_t oversampling,
-                           TransmitStatus *tsp) {
-  int32_t raw_temp = bme_get_temp_raw(oversampling, tsp);
+float bme_get_temp_degrees(const BmeDevice *dev, SensorConstants *scp,
+                           uint8_t oversampling, TransmitStatus *tsp) {
+  int32_t raw_temp = bme_get_temp_raw(dev, oversampling, tsp);
   int32_t temperature = compensate_temp(raw_temp, scp);
   float degree_temp = (float)temperature * 0.01;
   return degree_temp;
@@ -286,26 +447,22 @@ float bme_get_temp_degrees(SensorConstants *scp, uint8_t oversampling,
 
 
 // Get the raw humidity value.
+// dev: Pointer to the device handle.
 // oversampling: Choose humidity oversempling.
 //  Valid values are 1, 2, 4, 8 and 16 other values result in oversampling = 1.
 // tsp: Pointer to transmission status codes.
-uint32_t bme_get_hum_raw(uint8_t oversampling, TransmitStatus *tsp) {
+uint32_t bme_get_hum_raw(const BmeDevice *dev, uint8_t oversampling,
+                         TransmitStatus *tsp) {
   // Start the measurement but only for humidity.
-  uint8_t check_status = start_measurement(0, 0, oversampling, tsp);
+  uint8_t check_status = start_measurement(dev, 0, 0, oversampling, tsp);
   if (check_status != 0) {
     return check_status;
   }
-  // Prepare to read measured data from humidity register.
-  check_status = master_transmit_read_reg(BME280_ADDRESS_GND, BME280_HUM_REG);
-  if (check_status != 0) {
-    strcpy(tsp->status_msg, "HUM_REG_ERR");
-    return check_status;
-  }
   // Create buffer to store the humidity value.
   uint8_t hum_data_buf[BME280_HUM_LEN] = {};
   uint32_t raw_hum = 0x0;
   check_status =
-      master_receive_nbytes(BME280_ADDRESS_GND, hum_data_buf, BME280_HUM_LEN);
+      dev->bus->read_regs(dev, BME280_HUM_REG, hum_data_buf, BME280_HUM_LEN);
   if (check_status != 0) {
     strcpy(tsp->status_msg, "HUM_LD_ERR");
     return check_status;
@@ -318,13 +475,14 @@ uint32_t bme_get_hum_raw(uint8_t oversampling, TransmitStatus *tsp) {
 
 
 // Returns the raw measured humidity in degrees.
+// dev: Pointer to the device handle.
 // scp: Pointer to sensor constants.
 // oversampling: Choose humidity oversempling.
 //  Valid values are 1, 2, 4, 8 and 16 other values result in oversampling = 1.
 // tsp: Pointer to transmission status codes.
-float bme_get_hum_percent(SensorConstants *scp, uint8_t oversampling,
-                          TransmitStatus *tsp) {
-  uint32_t raw_hum = bme_get_hum_raw(oversampling, tsp);
+float bme_get_hum_percent(const BmeDevice *dev, SensorConstants *scp,
+                          uint8_t oversampling, TransmitStatus *tsp) {
+  uint32_t raw_hum = bme_get_hum_raw(dev, oversampling, tsp);
   uint32_t humidity = compensate_hum(raw_hum, scp);
   float percent_hum = (float)humidity / 1024;
   return percent_hum;
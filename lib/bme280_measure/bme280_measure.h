@@ -12,6 +12,13 @@
 // Address if SDO pin set to VCC
 #define BME280_ADDRESS_VCC 0x77
 
+// SPI
+// Default chip select pin (PB2 / SS, Arduino pin 10)
+#define BME280_SPI_CS_PIN 2
+// Bit 7 of the register address selects read (1) or write (0)
+#define BME280_SPI_READ 0x80
+#define BME280_SPI_WRITE_MASK 0x7F
+
 // Compensation values
 // Goes until 0xA1 (26 Bytes)
 #define BME280_COMPENSATE_REG_1 0x88
@@ -31,12 +38,28 @@
 #define BME280_CYCLE_MEAS 0x03
 #define BME280_SLEEP 0x00
 
+// Status register, bit 3 is set while a conversion is running
+#define BME280_STATUS_REG 0xF3
+#define BME280_STATUS_MEASURING 0x08
+
 // Oversampling settings register for humidity
 #define BME280_CONTROL_HUM_REG 0xF2
 
 #define BME280_CONFIG_REG 0xF5
+// Standby time between measurements in normal mode (config bits 7-5)
+#define BME280_STANDBY_0_5_MS 0b000
+#define BME280_STANDBY_62_5_MS 0b001
+#define BME280_STANDBY_125_MS 0b010
+#define BME280_STANDBY_250_MS 0b011
+#define BME280_STANDBY_500_MS 0b100
+#define BME280_STANDBY_1000_MS 0b101
+#define BME280_STANDBY_10_MS 0b110
+#define BME280_STANDBY_20_MS 0b111
 
 // Read registers
+// Burst of all measurements, press (3), temp (3), hum (2)
+#define BME280_DATA_REG 0xF7
+#define BME280_DATA_LEN 8
 #define BME280_TEMP_REG 0xFA
 #define BME280_TEMP_LEN 3
 #define BME280_HUM_REG 0xFD
@@ -84,19 +107,68 @@ typedef struct {
   uint8_t chip_id;
 } TransmitStatus;
 
+// Oversampling: 1, 2, 4, 8 or 16, 0 skips the channel.
+typedef struct {
+  uint8_t ovs_t;
+  uint8_t ovs_p;
+  uint8_t ovs_h;
+  // BME280_FORCE_MEAS, BME280_CYCLE_MEAS (normal mode) or BME280_SLEEP
+  uint8_t mode;
+  // BME280_STANDBY_*, only used in normal mode
+  uint8_t standby;
+} MeasureConfig;
+
+typedef struct BmeDevice BmeDevice;
+
+// Transport used to talk to the sensor.
+// Both functions return 0 for success.
+typedef struct {
+  // Read num_bytes consecutive registers beginning with reg.
+  uint8_t (*read_regs)(const BmeDevice *dev, uint8_t reg, uint8_t *storage,
+                       uint8_t num_bytes);
+  // Write value to a single register.
+  uint8_t (*write_reg)(const BmeDevice *dev, uint8_t reg, uint8_t value);
+} BmeBus;
+
+struct BmeDevice {
+  const BmeBus *bus;
+  // I2C address or chip select pin (port B), depending on the bus.
+  uint8_t bus_id;
+};
+
 // Compensation Formulae
 int32_t compensate_temp(uint32_t raw_temp, SensorConstants *scp);
 uint32_t compensate_hum(uint32_t raw_hum, SensorConstants *scp);
 
+// create device handles, the bus itself has to be initialized beforehand
+// (init_i2c or init_spi)
+void bme_create_i2c_device(BmeDevice *dev, uint8_t address);
+uint8_t bme_create_spi_device(BmeDevice *dev, uint8_t cs_pin);
+
 // initialize sensor, returns Chip-ID
-void bme_init(TransmitStatus *tsp);
+void bme_init(const BmeDevice *dev, TransmitStatus *tsp);
 // read out fixed constants
-void bme_load_comp_vals(SensorConstants *scp, TransmitStatus *tsp);
+void bme_load_comp_vals(const BmeDevice *dev, SensorConstants *scp,
+                        TransmitStatus *tsp);
+// read all raw measurements in one burst, 0 for success
+uint8_t bme_read_raw_data(const BmeDevice *dev, RawData *rdp,
+                          TransmitStatus *tsp);
+// set oversampling per channel, mode and standby time
+void bme_configure(const BmeDevice *dev, const MeasureConfig *mcp,
+                   TransmitStatus *tsp);
+// sample all configured channels (triggers it in forced mode), 0 for success
+uint8_t bme_measure(const BmeDevice *dev, const MeasureConfig *mcp,
+                    RawData *rdp, TransmitStatus *tsp);
+// wait for the next completed measurement in normal mode, 0 if there is one
+uint8_t bme_wait_new_data(const BmeDevice *dev, const MeasureConfig *mcp,
+                          TransmitStatus *tsp);
 // get temperature
-uint32_t bme_get_temp_raw(uint8_t oversampling, TransmitStatus *tsp);
-float bme_get_temp_degrees(SensorConstants *scp, uint8_t oversampling,
-                           TransmitStatus *tsp);
-uint32_t bme_get_hum_raw(uint8_t oversampling, TransmitStatus *tsp);
-float bme_get_hum_percent(SensorConstants *scp, uint8_t oversampling,
-                             TransmitStatus *tsp);
+uint32_t bme_get_temp_raw(const BmeDevice *dev, uint8_t oversampling,
+                          TransmitStatus *tsp);
+float bme_get_temp_degrees(const BmeDevice *dev, SensorConstants *scp,
+                           uint8_t oversampling, TransmitStatus *tsp);
+uint32_t bme_get_hum_raw(const BmeDevice *dev, uint8_t oversampling,
+                         TransmitStatus *tsp);
+float bme_get_hum_percent(const BmeDevice *dev, SensorConstants *scp,
+                          uint8_t oversampling, TransmitStatus *tsp);
 #endif // BME280_MEASURE_H
@@ -0,0 +1,164 @@
+#include "command_channel.h"
+#include "bme280_measure.h"
+#include "mem_usage.h"
+#include "uart_transmission.h"
+#include <avr/pgmspace.h>
+#include <stdint.h>
+
+// Internal results of execute_line on top of the COMMAND_* flags.
+#define COMMAND_ANSWERED 0x80
+#define COMMAND_INVALID 0xFF
+
+static char line[COMMAND_MAX_LEN];
+static uint8_t line_len = 0;
+// Set if the current line didn't fit, it's answered with ERR.
+static uint8_t line_overflow = 0;
+
+
+// Local function to parse an unsigned decimal number.
+// Returns 0 for success.
+uint8_t parse_number(const char *digits, uint8_t len, uint16_t *value) {
+  uint32_t result = 0;
+  if (len == 0) {
+    return 1;
+  }
+  for (uint8_t i = 0; i < len; i++) {
+    if ((digits[i] < '0') || (digits[i] > '9')) {
+      return 1;
+    }
+    result = result * 10 + (digits[i] - '0');
+    if (result > 0xFFFF) {
+      return 1;
+    }
+  }
+  *value = (uint16_t)result;
+  return 0;
+}
+
+
+// Local function to check the oversampling values the sensor supports.
+uint8_t valid_oversampling(uint16_t ovs) {
+  return (ovs == 0) || (ovs == 1) || (ovs == 2) || (ovs == 4) || (ovs == 8) ||
+         (ovs == 16);
+}
+
+
+// Local function to send the configuration in command syntax.
+void send_config(const NodeConfig *ncp) {
+  send_string_P(PSTR("OT"));
+  send_unsigned_decimal(ncp->measure.ovs_t);
+  send_string_P(PSTR(" OP"));
+  send_unsigned_decimal(ncp->measure.ovs_p);
+  send_string_P(PSTR(" OH"));
+  send_unsigned_decimal(ncp->measure.ovs_h);
+  send_string_P(PSTR(" P"));
+  send_unsigned_decimal(ncp->period_ms);
+  send_string_P(ncp->measure.mode == BME280_CYCLE_MEAS ? PSTR(" MN")
+                                                        : PSTR(" MF"));
+  send_string_P(ncp->output_format == OUTPUT_COMPACT ? PSTR(" FC")
+                                                      : PSTR(" FT"));
+  send_string_P(ncp->streaming ? PSTR(" S1\r\n") : PSTR(" S0\r\n"));
+}
+
+
+// Local function to run a complete command line.
+// Returns COMMAND_* flags, COMMAND_INVALID if the command was invalid.
+uint8_t execute_line(NodeConfig *ncp) {
+  uint16_t value = 0;
+  if (line_len == 0) {
+    return COMMAND_INVALID;
+  }
+  switch (line[0]) {
+  case 'O':
+    if ((line_len < 3) || (parse_number(line + 2, line_len - 2, &value) != 0) ||
+        !valid_oversampling(value)) {
+      return COMMAND_INVALID;
+    }
+    if (line[1] == 'T') {
+      ncp->measure.ovs_t = value;
+    } else if (line[1] == 'P') {
+      ncp->measure.ovs_p = value;
+    } else if (line[1] == 'H') {
+      ncp->measure.ovs_h = value;
+    } else {
+      return COMMAND_INVALID;
+    }
+    return COMMAND_RECONFIGURE;
+  case 'P':
+    if ((parse_number(line + 1, line_len - 1, &value) != 0) ||
+        ((value != 0) && (value < COMMAND_PERIOD_MIN)) ||
+        (value > COMMAND_PERIOD_MAX)) {
+      return COMMAND_INVALID;
+    }
+    ncp->period_ms = value;
+    return 0;
+  case 'M':
+    if ((line_len != 2) || ((line[1] != 'F') && (line[1] != 'N'))) {
+      return COMMAND_INVALID;
+    }
+    ncp->measure.mode = (line[1] == 'N') ? BME280_CYCLE_MEAS : BME280_FORCE_MEAS;
+    return COMMAND_RECONFIGURE;
+  case 'F':
+    if ((line_len != 2) || ((line[1] != 'T') && (line[1] != 'C'))) {
+      return COMMAND_INVALID;
+    }
+    ncp->output_format = (line[1] == 'C') ? OUTPUT_COMPACT : OUTPUT_TEXT;
+    return 0;
+  case 'S':
+    if ((line_len != 2) || ((line[1] != '0') && (line[1] != '1'))) {
+      return COMMAND_INVALID;
+    }
+    ncp->streaming = line[1] - '0';
+    return 0;
+  case 'Q':
+    return (line_len == 1) ? COMMAND_SAMPLE : COMMAND_INVALID;
+  case '?':
+    if (line_len != 1) {
+      return COMMAND_INVALID;
+    }
+    send_config(ncp);
+    MEM_REPORT();
+    return COMMAND_ANSWERED;
+  default:
+    return COMMAND_INVALID;
+  }
+}
+
+
+// Collect chars until the end of a line, then run the command.
+// ncp: Pointer to the node configuration the commands change.
+// received: Next char from the UART.
+uint8_t command_feed(NodeConfig *ncp, char received) {
+  if ((received != '\r') && (received != '\n')) {
+    if (line_len < COMMAND_MAX_LEN) {
+      line[line_len++] = received;
+    } else {
+      line_overflow = 1;
+    }
+    return 0;
+  }
+  if ((line_len == 0) && !line_overflow) {
+    // Empty line or the second half of "\r\n".
+    return 0;
+  }
+  uint8_t actions = line_overflow ? COMMAND_INVALID : execute_line(ncp);
+  line_len = 0;
+  line_overflow = 0;
+  if (actions == COMMAND_INVALID) {
+    command_answer(1);
+    return 0;
+  }
+  // A sample or the configuration is the answer itself, a reconfiguration
+  // is answered by the caller once the sensor took it.
+  if (!(actions & (COMMAND_SAMPLE | COMMAND_ANSWERED | COMMAND_RECONFIGURE))) {
+    command_answer(0);
+  }
+  return actions & ~COMMAND_ANSWERED;
+}
+
+
+// Answer a command with "OK" or "ERR".
+// failed: 0 for OK, anything else for ERR.
+void command_answer(uint8_t failed) {
+  send_string_P(failed ? PSTR("ERR\r\n") : PSTR("OK\r\n"));
+}
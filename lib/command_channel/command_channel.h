@@ -0,0 +1,45 @@
+#ifndef COMMAND_CHANNEL_H
+#define COMMAND_CHANNEL_H
+#include "bme280_measure.h"
+#include <stdint.h>
+
+// Line based commands received over the UART, ended by '\r' or '\n':
+//   OT<n>, OP<n>, OH<n>  oversampling of temperature, pressure, humidity
+//                        (0, 1, 2, 4, 8 or 16, 0 skips the channel)
+//   P<ms>                sample period while streaming (10 to 60000),
+//                        P0 streams as fast as the sensor delivers
+//   MF, MN               forced or normal measurement mode
+//   FT, FC               text or compact output format
+//   S1, S0               streaming on or off (off: samples only on Q)
+//   Q                    take and send one sample now
+//   ?                    send the current configuration (and the SRAM
+//                        numbers with -DMEM_USAGE_ENABLED)
+// Commands are answered with "OK" or "ERR", Q with the sample itself (or
+// the status of the failed measurement).
+// OT/OP/OH and MF/MN return COMMAND_RECONFIGURE unanswered, the caller
+// answers with command_answer once the sensor has been reconfigured.
+
+#define COMMAND_MAX_LEN 8
+
+#define OUTPUT_TEXT 0
+#define OUTPUT_COMPACT 1
+
+#define COMMAND_PERIOD_MIN 10
+#define COMMAND_PERIOD_MAX 60000
+
+// Actions left to the caller, returned as bit flags by command_feed.
+#define COMMAND_RECONFIGURE 0x01
+#define COMMAND_SAMPLE 0x02
+
+typedef struct {
+  MeasureConfig measure;
+  uint16_t period_ms;
+  uint8_t output_format;
+  uint8_t streaming;
+} NodeConfig;
+
+// Feed one received char, returns COMMAND_* flags (0 for nothing to do).
+uint8_t command_feed(NodeConfig *ncp, char received);
+// Send "OK" (failed == 0) or "ERR".
+void command_answer(uint8_t failed);
+#endif // COMMAND_CHANNEL_H
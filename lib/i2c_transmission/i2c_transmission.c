@@ -148,8 +148,8 @@ uint8_t master_receive_byte(uint8_t address, uint8_t *storage) {
 uint8_t master_receive_nbytes(uint8_t address, uint8_t *storage,
                               uint8_t num_bytes) {
   if (num_bytes < 2) {
-    master_receive_byte(address, storage);
-    return 0;
+    // Single byte reads are NACKed right away, pass on their status.
+    return master_receive_byte(address, storage);
   }
   // Prepare to receive and set Start Bit.
   TWCR = (1 << TWEN) | (1 << TWSTA) | (1 << TWINT);
@@ -0,0 +1,135 @@
+#include "mem_usage.h"
+#ifdef MEM_USAGE_ENABLED
+#include "uart_transmission.h"
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdint.h>
+#include <util/atomic.h>
+
+#define MEM_CANARY 0xC5
+
+// Linker and avr-libc symbols.
+extern uint8_t __data_start;
+extern uint8_t _end;
+extern uint8_t __heap_start;
+extern char *__brkval;
+
+// free_min starts at its maximum, a gap of 0 is a valid (fatal) reading.
+MemUsageStats mem_usage_stats = {.free_min = UINT16_MAX};
+
+#define MEM_SUBSYS_NAME(id, name)                                             \
+  static const char subsys_name_##id[] PROGMEM = name;
+MEM_SUBSYS_LIST(MEM_SUBSYS_NAME)
+#define MEM_SUBSYS_NAME_PTR(id, name) subsys_name_##id,
+static const char *const subsys_names[MEM_SUBSYS_COUNT] PROGMEM = {
+    MEM_SUBSYS_LIST(MEM_SUBSYS_NAME_PTR)};
+
+
+// Fill everything from the end of .bss up to RAMEND with the canary.
+// Runs before the stack pointer is set up, so no C and no stack here.
+void mem_paint_stack(void) __attribute__((naked, used, section(".init1")));
+void mem_paint_stack(void) {
+  __asm volatile("    ldi r30, lo8(_end)\n"
+                 "    ldi r31, hi8(_end)\n"
+                 "    ldi r24, %0\n"
+                 "    ldi r25, hi8(%1)\n"
+                 "    rjmp 2f\n"
+                 "1:  st Z+, r24\n"
+                 "2:  cpi r30, lo8(%1)\n"
+                 "    cpc r31, r25\n"
+                 "    brlo 1b\n"
+                 "    breq 1b\n" ::"M"(MEM_CANARY),
+                 "i"(RAMEND));
+}
+
+
+// Local function to get the first byte above the heap.
+static uint8_t *heap_end(void) {
+  return (__brkval != 0) ? (uint8_t *)__brkval : &__heap_start;
+}
+
+
+// Local function to find the lowest address the stack has written to.
+static uint8_t *lowest_touched(void) {
+  uint8_t *pos = heap_end();
+  uint8_t *stack_pointer = (uint8_t *)SP;
+  while ((pos < stack_pointer) && (*pos == MEM_CANARY)) {
+    pos++;
+  }
+  return pos;
+}
+
+
+// Local function to fold the current paint state into the stats.
+// Returns the stack depth in bytes.
+static uint16_t update_peak(void) {
+  // Link time constant, kept here so a debugger sees it without a report.
+  mem_usage_stats.static_size = (uint16_t)(&_end - &__data_start);
+  uint8_t *lowest = lowest_touched();
+  uint16_t depth = (uint16_t)((uint8_t *)RAMEND + 1 - lowest);
+  uint16_t gap = (uint16_t)(lowest - heap_end());
+  if (depth > mem_usage_stats.stack_peak) {
+    mem_usage_stats.stack_peak = depth;
+  }
+  if (gap < mem_usage_stats.free_min) {
+    mem_usage_stats.free_min = gap;
+  }
+  return depth;
+}
+
+
+uint16_t mem_stack_high_water(void) {
+  update_peak();
+  return mem_usage_stats.stack_peak;
+}
+
+
+uint16_t mem_free_gap(void) {
+  return (uint16_t)((uint8_t *)SP - heap_end());
+}
+
+
+// Repaint the free area, the following code starts from a clean state.
+void mem_checkpoint_begin(MemSubsystem subsys) {
+  (void)subsys;
+  // Keep the mark set so far before it gets painted over.
+  update_peak();
+  // Nothing below SP is in use, as long as no interrupt pushes onto it.
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    uint8_t *stack_pointer = (uint8_t *)SP;
+    for (uint8_t *pos = heap_end(); pos < stack_pointer; pos++) {
+      *pos = MEM_CANARY;
+    }
+  }
+}
+
+
+void mem_checkpoint_end(MemSubsystem subsys) {
+  uint16_t depth = update_peak();
+  if ((subsys < MEM_SUBSYS_COUNT) &&
+      (depth > mem_usage_stats.subsys_peak[subsys])) {
+    mem_usage_stats.subsys_peak[subsys] = depth;
+  }
+}
+
+
+void mem_report(void) {
+  update_peak();
+  send_string_P(PSTR("\r\nMemory usage:\r\nStatic: "));
+  send_unsigned_decimal(mem_usage_stats.static_size);
+  send_string_P(PSTR(" B\r\nStack peak: "));
+  send_unsigned_decimal(mem_usage_stats.stack_peak);
+  send_string_P(PSTR(" B\r\nFree now: "));
+  send_unsigned_decimal(mem_free_gap());
+  send_string_P(PSTR(" B\r\nFree min: "));
+  send_unsigned_decimal(mem_usage_stats.free_min);
+  send_string_P(PSTR(" B\r\n"));
+  for (uint8_t i = 0; i < MEM_SUBSYS_COUNT; i++) {
+    send_string_P(PSTR("Peak "));
+    send_string_P((const char *)pgm_read_word(&subsys_names[i]));
+    send_string_P(PSTR(": "));
+    send_unsigned_decimal(mem_usage_stats.subsys_peak[i]);
+    send_string_P(PSTR(" B\r\n"));
+  }
+}
+#endif // MEM_USAGE_ENABLED
@@ -0,0 +1,70 @@
+#ifndef MEM_USAGE_H
+#define MEM_USAGE_H
+#include <stdint.h>
+
+// Optional SRAM instrumentation, compiled in with -DMEM_USAGE_ENABLED
+// (build_flags in platformio.ini). Without the flag all macros below expand
+// to nothing and the module costs neither flash nor SRAM.
+//
+// The free SRAM between the end of .bss and RAMEND is painted with a canary
+// during startup (.init1). The lowest overwritten canary marks the deepest
+// the stack has ever been. A checkpoint pair repaints the free area and
+// attributes everything used until MEM_CHECKPOINT_END to that subsystem.
+//
+// All numbers are kept in mem_usage_stats, so a simulator or debugger can
+// check them without the UART. `make mem-check` in host/ runs the firmware
+// (env uno_memcheck) in simavr and checks them against limits.
+
+// Subsystems tracked at checkpoints as X(id, name), the enum below and the
+// report names are generated from it. This header is also used by
+// host/simavr_mem_check to read mem_usage_stats, keep it free of AVR
+// headers.
+#define MEM_SUBSYS_LIST(X)                                                    \
+  X(BME_INIT, "bme init")                                                     \
+  X(BME_MEASURE, "bme measure")                                               \
+  X(UART, "uart")                                                             \
+  X(COMMAND, "command")
+
+#define MEM_SUBSYS_ENUM(id, name) MEM_SUBSYS_##id,
+typedef enum { MEM_SUBSYS_LIST(MEM_SUBSYS_ENUM) MEM_SUBSYS_COUNT } MemSubsystem;
+#undef MEM_SUBSYS_ENUM
+
+typedef struct {
+  // .data + .bss in bytes, set at the first checkpoint.
+  uint16_t static_size;
+  // Most stack bytes ever used (high-water mark).
+  uint16_t stack_peak;
+  // Smallest gap between heap end and stack seen at a checkpoint,
+  // UINT16_MAX until the first one.
+  uint16_t free_min;
+  // Deepest stack (bytes below RAMEND) reached within each subsystem.
+  uint16_t subsys_peak[MEM_SUBSYS_COUNT];
+} MemUsageStats;
+
+// Only uint16_t fields, so the layout is the same on the AVR and the host.
+_Static_assert(sizeof(MemUsageStats) ==
+                   (3 + MEM_SUBSYS_COUNT) * sizeof(uint16_t),
+               "MemUsageStats has to stay a plain uint16_t layout");
+
+#ifdef MEM_USAGE_ENABLED
+extern MemUsageStats mem_usage_stats;
+
+// Stack high-water mark in bytes since reset.
+uint16_t mem_stack_high_water(void);
+// Current gap between heap end and stack pointer in bytes.
+uint16_t mem_free_gap(void);
+void mem_checkpoint_begin(MemSubsystem subsys);
+void mem_checkpoint_end(MemSubsystem subsys);
+// Send all numbers over the UART, done on the '?' command so the sample
+// stream stays untouched.
+void mem_report(void);
+
+#define MEM_CHECKPOINT_BEGIN(subsys) mem_checkpoint_begin(subsys)
+#define MEM_CHECKPOINT_END(subsys) mem_checkpoint_end(subsys)
+#define MEM_REPORT() mem_report()
+#else
+#define MEM_CHECKPOINT_BEGIN(subsys) ((void)0)
+#define MEM_CHECKPOINT_END(subsys) ((void)0)
+#define MEM_REPORT() ((void)0)
+#endif // MEM_USAGE_ENABLED
+#endif // MEM_USAGE_H
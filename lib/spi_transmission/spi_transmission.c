@@ -0,0 +1,104 @@
+#include "spi_transmission.h"
+#include "avr/io.h"
+#include <stdint.h>
+
+
+uint8_t init_spi(uint8_t clock_div) {
+  // SPR1, SPR0 select the divider, SPI2X doubles the resulting speed.
+  uint8_t spr_bits;
+  uint8_t double_speed;
+  switch (clock_div) {
+  case 2:
+    spr_bits = 0b00;
+    double_speed = 1;
+    break;
+  case 4:
+    spr_bits = 0b00;
+    double_speed = 0;
+    break;
+  case 8:
+    spr_bits = 0b01;
+    double_speed = 1;
+    break;
+  case 16:
+    spr_bits = 0b01;
+    double_speed = 0;
+    break;
+  case 32:
+    spr_bits = 0b10;
+    double_speed = 1;
+    break;
+  case 64:
+    spr_bits = 0b10;
+    double_speed = 0;
+    break;
+  case 128:
+    spr_bits = 0b11;
+    double_speed = 0;
+    break;
+  default:
+    // Error: Divider not supported by the hardware!
+    return 1;
+  }
+  // SS has to be an output, otherwise a low level on it would switch the
+  // hardware back into slave mode. Keep it high (deselected).
+  PORTB |= (1 << SPI_SS_PIN);
+  DDRB |= (1 << SPI_SS_PIN) | (1 << SPI_MOSI_PIN) | (1 << SPI_SCK_PIN);
+  DDRB &= ~(1 << SPI_MISO_PIN);
+  // Enable SPI as master, MSB first, mode 0 (CPOL = 0, CPHA = 0).
+  SPCR = (1 << SPE) | (1 << MSTR) | spr_bits;
+  SPSR = double_speed << SPI2X;
+  return 0;
+}
+
+
+uint8_t spi_init_cs(uint8_t cs_pin) {
+  if ((cs_pin > 7) || (cs_pin == SPI_MOSI_PIN) || (cs_pin == SPI_MISO_PIN) ||
+      (cs_pin == SPI_SCK_PIN)) {
+    // Error: Pin is not available as chip select!
+    return 1;
+  }
+  // Set it high first so the slave does not see a falling edge.
+  PORTB |= (1 << cs_pin);
+  DDRB |= (1 << cs_pin);
+  return 0;
+}
+
+
+uint8_t spi_transfer_byte(uint8_t data) {
+  SPDR = data;
+  // Wait until the byte has been shifted out completely.
+  while (!(SPSR & (1 << SPIF)))
+    ;
+  return SPDR;
+}
+
+
+uint8_t spi_read_nbytes(uint8_t cs_pin, uint8_t reg, uint8_t *storage,
+                        uint8_t num_bytes) {
+  if (num_bytes == 0) {
+    // Error: Nothing to read!
+    return 1;
+  }
+  // Select slave.
+  PORTB &= ~(1 << cs_pin);
+  spi_transfer_byte(reg);
+  // Clock out dummy bytes, the slave answers on MISO.
+  for (uint8_t i = 0; i < num_bytes; i++) {
+    *(storage + i) = spi_transfer_byte(0x00);
+  }
+  // Deselect slave, ends the burst.
+  PORTB |= (1 << cs_pin);
+  return 0;
+}
+
+
+uint8_t spi_write_to_reg(uint8_t cs_pin, uint8_t reg, uint8_t value) {
+  // Select slave.
+  PORTB &= ~(1 << cs_pin);
+  spi_transfer_byte(reg);
+  spi_transfer_byte(value);
+  // Deselect slave.
+  PORTB |= (1 << cs_pin);
+  return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef SPI_TRANSMISSION_H
+#define SPI_TRANSMISSION_H
+
+#include <stdint.h>
+
+// Hardware SPI pins of the ATmega328P (all on port B).
+#define SPI_SS_PIN 2
+#define SPI_MOSI_PIN 3
+#define SPI_MISO_PIN 4
+#define SPI_SCK_PIN 5
+
+// All functions except spi_transfer_byte return 0 for success.
+// clock_div: SYS_CLK divider, valid values are 2, 4, 8, 16, 32, 64 and 128.
+uint8_t init_spi(uint8_t clock_div);
+// Configure a pin on port B as chip select (output, idle high).
+uint8_t spi_init_cs(uint8_t cs_pin);
+// Shift out one byte and return the byte shifted in at the same time.
+uint8_t spi_transfer_byte(uint8_t data);
+uint8_t spi_read_nbytes(uint8_t cs_pin, uint8_t reg, uint8_t *storage,
+                        uint8_t num_bytes);
+uint8_t spi_write_to_reg(uint8_t cs_pin, uint8_t reg, uint8_t value);
+#endif // SPI_TRANSMISSION_H
@@ -0,0 +1,29 @@
+#include "system_timer.h"
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stdint.h>
+#include <util/atomic.h>
+
+static volatile uint32_t millis = 0;
+
+
+void init_system_timer(void) {
+  // 16 MHz / 64 = 250 kHz, compare match after 250 ticks gives 1 kHz.
+  TCCR0A = (1 << WGM01);
+  TCCR0B = (1 << CS01) | (1 << CS00);
+  OCR0A = 249;
+  TIMSK0 = (1 << OCIE0A);
+}
+
+
+ISR(TIMER0_COMPA_vect) {
+  millis++;
+}
+
+
+uint32_t timer_millis(void) {
+  uint32_t now;
+  // 32 bit read isn't atomic on AVR.
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { now = millis; }
+  return now;
+}
@@ -0,0 +1,10 @@
+#ifndef SYSTEM_TIMER_H
+#define SYSTEM_TIMER_H
+#include <stdint.h>
+
+// Millisecond tick from Timer0 in CTC mode.
+// Needs interrupts enabled (sei).
+void init_system_timer(void);
+// Milliseconds since init_system_timer, wraps after about 49 days.
+uint32_t timer_millis(void);
+#endif // SYSTEM_TIMER_H
@@ -1,17 +1,63 @@
 #include "uart_transmission.h"
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stdlib.h>
 
+// Ring buffer between the RX interrupt and receive_char.
+// Free running indices, masked on access.
+static volatile char rx_buffer[UART_RX_BUF_LEN];
+static volatile uint8_t rx_head = 0;
+static volatile uint8_t rx_tail = 0;
 
-void init_uart_transmission(uint16_t baud_rate) {
+
+// Local function to get the baud rate register value closest to baud_rate
+// for a clock divider (16 normal speed, 8 double speed).
+// error: Resulting deviation in 0.01 % of baud_rate.
+uint16_t baud_reg_for_divider(uint32_t baud_rate, uint8_t divider,
+                              int32_t *error) {
+  uint32_t step = (uint32_t)divider * baud_rate;
+  // Rounded SYS_CLK / step, the register holds that value minus one.
+  uint32_t reg_rate = (SYS_CLK + step / 2) / step;
+  if (reg_rate < 1) {
+    reg_rate = 1;
+  } else if (reg_rate > UART_BAUD_REG_MAX + 1) {
+    reg_rate = UART_BAUD_REG_MAX + 1;
+  }
+  uint32_t actual = SYS_CLK / ((uint32_t)divider * reg_rate);
+  *error = (int32_t)(((int64_t)actual - baud_rate) * 10000 / baud_rate);
+  return (uint16_t)(reg_rate - 1);
+}
+
+
+int16_t init_uart_transmission(uint32_t baud_rate) {
+  if (baud_rate == 0) {
+    return INT16_MAX;
+  }
+  // Double speed halves the divider, that gives a finer grid for high
+  // rates. Prefer normal speed on a tie, it samples each bit more often.
+  int32_t error_normal;
+  int32_t error_double;
+  uint16_t reg_normal = baud_reg_for_divider(baud_rate, 16, &error_normal);
+  uint16_t reg_double = baud_reg_for_divider(baud_rate, 8, &error_double);
+  uint8_t double_speed = labs(error_double) < labs(error_normal);
+  uint16_t reg_rate = double_speed ? reg_double : reg_normal;
+  int32_t error = double_speed ? error_double : error_normal;
   // Configure value for register containing baud rate.
-  uint16_t reg_rate = SYS_CLK / 16 / baud_rate - 1;
-  // reg_rate = 103;
-  // USART_BAUD_RATE_16 = reg_rate;
   UBRR0L = (uint8_t)(reg_rate & 0xFF);
   UBRR0H = (uint8_t)(reg_rate >> 8);
-  // Enable Transmission (Receiving is not needed).
+  if (double_speed) {
+    UCSR0A |= (1 << U2X0);
+  } else {
+    UCSR0A &= ~(1 << U2X0);
+  }
+  // Enable Transmission and Receiving with interrupt.
   // Let other default values as they are.
-  UCSR0B |= (1 << TXEN0);
+  UCSR0B |= (1 << TXEN0) | (1 << RXEN0) | (1 << RXCIE0);
   UCSR0C = 0b00000110;
+  if (error > INT16_MAX) {
+    return INT16_MAX;
+  }
+  return (error < INT16_MIN) ? INT16_MIN : (int16_t)error;
 }
 
 
@@ -32,6 +78,17 @@ void send_string(const char *to_send) {
 }
 
 
+void send_string_P(const char *to_send) {
+  // Read byte by byte from flash, nothing is copied to SRAM.
+  char next = pgm_read_byte(to_send);
+  while (next) {
+    send_char(next);
+    to_send++;
+    next = pgm_read_byte(to_send);
+  }
+}
+
+
 void send_unsigned_decimal(uint64_t to_send) {
   // Max. Number has 20 digits.
   // Additional "-" sign and end of string leads to 22 chars.
@@ -86,3 +143,26 @@ void send_float(float to_send, uint8_t precision) {
     }
   }
 }
+
+
+ISR(USART_RX_vect) {
+  // Status has to be read before the data register.
+  uint8_t frame_error = UCSR0A & ((1 << FE0) | (1 << DOR0));
+  char received = UDR0;
+  if (frame_error || ((uint8_t)(rx_head - rx_tail) >= UART_RX_BUF_LEN)) {
+    // Drop garbled chars and chars that don't fit anymore.
+    return;
+  }
+  rx_buffer[rx_head & (UART_RX_BUF_LEN - 1)] = received;
+  rx_head++;
+}
+
+
+uint8_t receive_char(char *storage) {
+  if (rx_head == rx_tail) {
+    return 1;
+  }
+  *storage = rx_buffer[rx_tail & (UART_RX_BUF_LEN - 1)];
+  rx_tail++;
+  return 0;
+}
@@ -4,12 +4,24 @@
 #include <stdint.h>
 
 #define SYS_CLK 16000000UL
+// Receive buffer filled by the RX interrupt, has to be a power of two.
+#define UART_RX_BUF_LEN 32
+// UBRR0 is 12 bits wide.
+#define UART_BAUD_REG_MAX 4095
 
-void init_uart_transmission(uint16_t baud_rate);
+// Picks normal or double speed (U2X0), whichever gets closer to baud_rate
+// (up to 2 Mbaud at 16 MHz). Returns the resulting baud rate error in
+// 0.01 %, the receiver tolerates about +-2 %.
+int16_t init_uart_transmission(uint32_t baud_rate);
 void send_char(const char to_send);
 void send_string(const char *to_send);
+// Same as send_string for strings in flash (PSTR / PROGMEM).
+void send_string_P(const char *to_send);
 void send_unsigned_decimal(uint64_t to_send);
 void send_signed_decimal(int64_t to_send);
 void send_float(float to_send, uint8_t precision);
+// Returns 0 if a received char was stored, 1 if nothing is waiting.
+// Needs interrupts enabled (sei).
+uint8_t receive_char(char *storage);
 
 #endif // UART_TRANSMISSION_H
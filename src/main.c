@@ -1,44 +1,253 @@
 #include "bme280_measure.h"
+#include "command_channel.h"
 #include "i2c_transmission.h"
+#include "mem_usage.h"
+#include "spi_transmission.h"
+#include "system_timer.h"
 #include "uart_transmission.h"
-#include <util/delay.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <string.h>
+
+#ifndef UART_BAUD_RATE
+// Same speed as monitor_speed in platformio.ini.
+#define UART_BAUD_RATE 9600
+#endif
+// Interval for reporting the achieved rate while streaming with P0.
+#define RATE_REPORT_MS 1000
+
+// Send a compensated sample in the configured format.
+// Humidity compensation needs t_fine of the same sample, so it is only
+// sent together with the temperature.
+void send_sample(const NodeConfig *ncp, SensorConstants *scp,
+                 const RawData *rdp, const TransmitStatus *tsp) {
+  uint8_t with_temp = ncp->measure.ovs_t != 0;
+  uint8_t with_hum = with_temp && (ncp->measure.ovs_h != 0);
+  uint8_t with_press = ncp->measure.ovs_p != 0;
+  int32_t temperature = 0;
+  uint32_t humidity = 0;
+  if (with_temp) {
+    temperature = compensate_temp(rdp->temperature_raw, scp);
+  }
+  if (with_hum) {
+    humidity = compensate_hum(rdp->humidity_raw, scp);
+  }
+  if (ncp->output_format == OUTPUT_COMPACT) {
+    // S,<0.01 °C>,<0.01 %RH>,<raw pressure>, skipped channels stay empty.
+    send_string_P(PSTR("S,"));
+    if (with_temp) {
+      send_signed_decimal(temperature);
+    }
+    send_char(',');
+    if (with_hum) {
+      send_unsigned_decimal(humidity * 100 / 1024);
+    }
+    send_char(',');
+    if (with_press) {
+      send_unsigned_decimal(rdp->pressure_raw);
+    }
+    send_string_P(PSTR("\r\n"));
+    return;
+  }
+  if (with_temp) {
+    send_string_P(PSTR("\r\n\r\nTemperature read status:\r\n"));
+    send_string(tsp->status_msg);
+    send_string_P(PSTR("\r\nTemperature in degrees: "));
+    send_float((float)temperature * 0.01, 2);
+    send_string_P(PSTR(" °C\r\n"));
+  }
+  if (with_hum) {
+    send_string_P(PSTR("\r\nHumidity read status:\r\n"));
+    send_string(tsp->status_msg);
+    send_string_P(PSTR("\r\nHumidity in percent: "));
+    send_float((float)humidity / 1024, 2);
+    send_string_P(PSTR(" %\r\n"));
+  }
+  if (with_press) {
+    send_string_P(PSTR("\r\nPressure raw: "));
+    send_unsigned_decimal(rdp->pressure_raw);
+    send_string_P(PSTR("\r\n"));
+  }
+}
+
+// Send the status of a failed measurement instead of a sample, so no stale
+// or uninitialized data goes out looking like a valid sample.
+void send_measure_error(const NodeConfig *ncp, const TransmitStatus *tsp) {
+  if (ncp->output_format == OUTPUT_COMPACT) {
+    send_string_P(PSTR("E,"));
+  } else {
+    send_string_P(PSTR("\r\n\r\nMeasurement error:\r\n"));
+  }
+  send_string(tsp->status_msg);
+  send_string_P(PSTR("\r\n"));
+}
+
+// Send the number of samples taken within the last second.
+void send_rate(const NodeConfig *ncp, uint16_t samples_per_second) {
+  if (ncp->output_format == OUTPUT_COMPACT) {
+    send_string_P(PSTR("R,"));
+    send_unsigned_decimal(samples_per_second);
+    send_string_P(PSTR("\r\n"));
+    return;
+  }
+  send_string_P(PSTR("\r\nSamples per second: "));
+  send_unsigned_decimal(samples_per_second);
+  send_string_P(PSTR("\r\n"));
+}
 
 int main() {
   TransmitStatus bme_transmit_status;
   SensorConstants bme_sensor_constants;
+  BmeDevice bme_device;
+  RawData bme_raw_data;
+  // Defaults, can be changed at runtime over the UART (see command_channel.h).
+#ifdef STREAM_PROFILE
+  // Fast transient capture: 1x oversampling, back to back normal mode
+  // measurements (about 6 ms each), every sample sent in compact format.
+  // Needs a high UART_BAUD_RATE, e.g. 1000000.
+  NodeConfig node_config = {
+      .measure = {.ovs_t = 1,
+                  .ovs_p = 0,
+                  .ovs_h = 1,
+                  .mode = BME280_CYCLE_MEAS,
+                  .standby = BME280_STANDBY_0_5_MS},
+      .period_ms = 0,
+      .output_format = OUTPUT_COMPACT,
+      .streaming = 1,
+  };
+#else
+  NodeConfig node_config = {
+      .measure = {.ovs_t = 16,
+                  .ovs_p = 0,
+                  .ovs_h = 16,
+                  .mode = BME280_FORCE_MEAS,
+                  .standby = BME280_STANDBY_1000_MS},
+      .period_ms = 5000,
+      .output_format = OUTPUT_TEXT,
+      .streaming = 1,
+  };
+#endif
+  int16_t baud_error = init_uart_transmission(UART_BAUD_RATE);
+  init_system_timer();
+  sei();
+  // Error comes in 0.01 %, print it as fixed point.
+  send_string_P(PSTR("\r\nBaud rate error: "));
+  if (baud_error < 0) {
+    send_char('-');
+    baud_error = -baud_error;
+  }
+  send_unsigned_decimal(baud_error / 100);
+  send_char('.');
+  send_char('0' + (baud_error / 10) % 10);
+  send_char('0' + baud_error % 10);
+  send_string_P(PSTR(" %\r\n"));
+  uint8_t bus_status;
+#ifdef BME280_USE_SPI
+  // Max SPI Speed for BME280 Sensor is 10 MHz,
+  // the hardware SPI runs at most at SYS_CLK / 2 = 8 MHz.
+  bus_status = init_spi(2);
+  if (bus_status == 0) {
+    bus_status = bme_create_spi_device(&bme_device, BME280_SPI_CS_PIN);
+  }
+#else
   // Max Speed for BME280 Sensor is 3.4 MHz
   // Arduino runs at 16 MHz
   // For I2C Clock of 400 kHz speed,
   // set value of 12 without prescaling.
-  init_i2c(12, 0);
-  bme_init(&bme_transmit_status);
+  bus_status = init_i2c(12, 0);
+  bme_create_i2c_device(&bme_device, BME280_ADDRESS_GND);
+#endif
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  if (bus_status != 0) {
+    // bme_device isn't usable, report like the other init errors and stop.
+    send_string_P(PSTR("\r\nInitialization status:\r\nBUS_INIT_ERR\r\n"));
+    while (1) {
+      sleep_mode();
+    }
+  }
+  MEM_CHECKPOINT_BEGIN(MEM_SUBSYS_BME_INIT);
+  bme_init(&bme_device, &bme_transmit_status);
   send_string("\r\nInitialization status:\r\n");
   send_string(bme_transmit_status.status_msg);
   send_string("\r\n");
-  bme_load_comp_vals(&bme_sensor_constants, &bme_transmit_status);
+  bme_load_comp_vals(&bme_device, &bme_sensor_constants, &bme_transmit_status);
+  MEM_CHECKPOINT_END(MEM_SUBSYS_BME_INIT);
   send_string("\r\nLoading Values status:\r\n");
   send_string(bme_transmit_status.status_msg);
   send_string("\r\n");
-  float temperature = 0;
-  float humidity = 0;
+  bme_configure(&bme_device, &node_config.measure, &bme_transmit_status);
+  uint32_t last_sample = timer_millis();
+  uint32_t rate_window_start = last_sample;
+  uint16_t rate_samples = 0;
   while (1) {
-    _delay_ms(5000);
-    temperature =
-        bme_get_temp_degrees(&bme_sensor_constants, 16, &bme_transmit_status);
-    send_string("\r\n\r\nTemperature read status:\r\n");
-    send_string(bme_transmit_status.status_msg);
-    send_string("\r\nTemperature in degrees: ");
-    send_float(temperature, 2);
-    send_string(" °C\r\n");
-    humidity =
-        bme_get_hum_percent(&bme_sensor_constants, 16, &bme_transmit_status);
-    // humidity = bme_get_hum_raw(16, &bme_transmit_status);
-    // uint32_t hum_comp = compensate_hum(humidity, &bme_sensor_constants);
-    send_string("\r\nHumidity read status:\r\n");
-    send_string(bme_transmit_status.status_msg);
-    send_string("\r\nHumidity in percent: ");
-    send_float(humidity, 2);
-    send_string(" %\r\n");
+    uint8_t actions = 0;
+    char received;
+    if (receive_char(&received) == 0) {
+      MEM_CHECKPOINT_BEGIN(MEM_SUBSYS_COMMAND);
+      do {
+        uint8_t command_actions = command_feed(&node_config, received);
+        if (command_actions & COMMAND_RECONFIGURE) {
+          // Only answer once the sensor took the new settings.
+          bme_configure(&bme_device, &node_config.measure,
+                        &bme_transmit_status);
+          command_answer(strcmp(bme_transmit_status.status_msg,
+                                "CONFIG_SUCC") != 0);
+        }
+        actions |= command_actions;
+      } while (receive_char(&received) == 0);
+      MEM_CHECKPOINT_END(MEM_SUBSYS_COMMAND);
+    }
+    uint32_t now = timer_millis();
+    uint8_t continuous = node_config.streaming && (node_config.period_ms == 0);
+    if (node_config.streaming && (now - last_sample >= node_config.period_ms)) {
+      last_sample = now;
+      actions |= COMMAND_SAMPLE;
+    }
+    if (actions & COMMAND_SAMPLE) {
+      MEM_CHECKPOINT_BEGIN(MEM_SUBSYS_BME_MEASURE);
+      uint8_t wait_status = 0;
+      if (continuous && (node_config.measure.mode == BME280_CYCLE_MEAS)) {
+        // Don't send the same sample twice.
+        wait_status = bme_wait_new_data(&bme_device, &node_config.measure,
+                                        &bme_transmit_status);
+      }
+      uint8_t measure_status = 0;
+      if (wait_status == 0) {
+        measure_status = bme_measure(&bme_device, &node_config.measure,
+                                     &bme_raw_data, &bme_transmit_status);
+      }
+      MEM_CHECKPOINT_END(MEM_SUBSYS_BME_MEASURE);
+      // Without new data the registers still hold the last sample, it is
+      // neither sent again nor counted. Only captured samples count in the
+      // reported rate.
+      if (wait_status == 0) {
+        MEM_CHECKPOINT_BEGIN(MEM_SUBSYS_UART);
+        if (measure_status == 0) {
+          send_sample(&node_config, &bme_sensor_constants, &bme_raw_data,
+                      &bme_transmit_status);
+          rate_samples++;
+        } else {
+          send_measure_error(&node_config, &bme_transmit_status);
+        }
+        MEM_CHECKPOINT_END(MEM_SUBSYS_UART);
+      }
+    }
+    if (continuous) {
+      now = timer_millis();
+      if (now - rate_window_start >= RATE_REPORT_MS) {
+        send_rate(&node_config,
+                  (uint32_t)rate_samples * 1000 / (now - rate_window_start));
+        rate_window_start = now;
+        rate_samples = 0;
+      }
+      // Next sample right away.
+      continue;
+    }
+    rate_window_start = now;
+    rate_samples = 0;
+    // Idle until the next received char or timer tick.
+    sleep_mode();
   }
   return 0;
 }